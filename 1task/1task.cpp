@@ -1,253 +1,825 @@
 #include "1task.h"
+#include "buffered_writer.h"
+#include <charconv>
+#include <cstring>
+#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
-void print_menu()
+struct ReplOptions
 {
-    std::cout << "1.  new A               - добавить новое множество A\n";
-    std::cout << "2.  del A               - удалить множество A\n";
-    std::cout << "3.  add A x             - добавить элемент x к множеству A\n";
-    std::cout << "4.  rem A x             - убрать элемент x из множества A\n";
-    std::cout << "5.  pow A               - вычислить булеан множества A\n";
-    std::cout << "6.  see [A]             - вывести множество A или все множества\n";
-    std::cout << "7.  A + B               - объединение множеств A и B\n";
-    std::cout << "8.  A & B               - пересечение множеств A и B\n";
-    std::cout << "9.  A - B               - разность множеств A и B\n";
-    std::cout << "10. A < B               - проверить, является ли A подмножеством B\n";
-    std::cout << "11. A = B               - проверить, равны ли множества A и B\n";
-    std::cout << "12. exit                - выход\n";
+    bool quiet = false;                 // не печатать подтверждения new/del/add/rem
+    SetJournal<Set> *journal = nullptr; // история undo/redo и файл журнала (--journal)
+};
+
+// множество, созданное командой (слиянием, выражением, загрузкой), попадает в журнал
+Set* journaled(Set* set, const ReplOptions& options)
+{
+    options.journal->note_created(*set);
+    return set;
 }
 
-int main()
+constexpr bool is_blank(char c)
 {
-#ifdef _WIN32
-    SetConsoleOutputCP(CP_UTF8);
-    SetConsoleCP(CP_UTF8);
-#endif
+    return c == ' ' || c == '\t' || c == '\r';
+}
 
-    std::string command;
+// перевод регистра только латинских букв, без обращения к локали
+constexpr char ascii_lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
 
-    while (true)
+constexpr char ascii_upper(char c)
+{
+    return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// Строка команды, разбитая на слова без копирования текста.
+struct CommandLine
+{
+    static constexpr std::size_t max_tokens = 32;
+
+    std::string_view tokens[max_tokens];
+    std::size_t count = 0;
+    bool truncated = false; // в строке больше max_tokens слов
+
+    explicit CommandLine(std::string_view line)
+    {
+        const char *p = line.data();
+        const char *end = p + line.size();
+        while (true)
+        {
+            while (p != end && is_blank(*p)) p++;
+            if (p == end) break;
+            if (count == max_tokens)
+            {
+                truncated = true;
+                break;
+            }
+            const char *word = p;
+            while (p != end && !is_blank(*p)) p++;
+            tokens[count++] = std::string_view(word, static_cast<std::size_t>(p - word));
+        }
+    }
+
+    std::string_view operator[](std::size_t i) const
+    {
+        return i < count ? tokens[i] : std::string_view{};
+    }
+};
+
+enum class Command
+{
+    none, // не ключевое слово: операция над двумя множествами или выражение
+    create, drop, add, remove, see, pow, unite, intersect, complement, product, stat,
+    subsets, supersets, lattice, save, load, duplicates, undo, redo, compact, help, exit
+};
+
+// Слово до 7 букв, упакованное в число: длина в старшем байте, затем буквы в нижнем
+// регистре. Разные слова дают разные ключи, поэтому команда опознаётся одним switch.
+constexpr uint64_t command_key(std::string_view word)
+{
+    if (word.size() > 7) return 0;
+    uint64_t key = word.size();
+    for (char c : word) key = key << 8 | static_cast<unsigned char>(ascii_lower(c));
+    return key;
+}
+
+Command command_of(std::string_view word)
+{
+    switch (command_key(word))
     {
-        std::cout << "\n> ";
-        std::getline(std::cin, command);
+    case command_key("new"): return Command::create;
+    case command_key("del"): return Command::drop;
+    case command_key("add"): return Command::add;
+    case command_key("rem"): return Command::remove;
+    case command_key("see"): return Command::see;
+    case command_key("pow"): return Command::pow;
+    case command_key("union"): return Command::unite;
+    case command_key("inter"): return Command::intersect;
+    case command_key("comp"): return Command::complement;
+    case command_key("prod"): return Command::product;
+    case command_key("stat"): return Command::stat;
+    case command_key("sub"): return Command::subsets;
+    case command_key("sup"): return Command::supersets;
+    case command_key("lattice"): return Command::lattice;
+    case command_key("save"): return Command::save;
+    case command_key("load"): return Command::load;
+    case command_key("dup"): return Command::duplicates;
+    case command_key("undo"): return Command::undo;
+    case command_key("redo"): return Command::redo;
+    case command_key("compact"): return Command::compact;
+    case command_key("help"): return Command::help;
+    case command_key("exit"): return Command::exit;
+    default: return Command::none;
+    }
+}
 
-        if (command.empty()) continue;
+// знак операции над множествами: + & - ^ < =
+bool is_operator(std::string_view word)
+{
+    return word.size() == 1 && std::string_view("+&-^<=").find(word[0]) != std::string_view::npos;
+}
 
-        size_t start = command.find_first_not_of(" \t");
-        size_t end = command.find_last_not_of(" \t");
-        if (start == std::string::npos) continue;
-        command = command.substr(start, end - start + 1);
+bool equals_ci(std::string_view word, std::string_view command)
+{
+    if (word.size() != command.size()) return false;
+    for (std::size_t i = 0; i < word.size(); i++)
+    {
+        if (ascii_lower(word[i]) != command[i]) return false;
+    }
+    return true;
+}
 
-        std::stringstream ss(command);
-        std::string action;
-        ss >> action;
+// Имя множества из команды, переведённое в верхний регистр. Имя до inline_size
+// символов пишется в буфер на стеке, и поиск в реестре обходится без выделения
+// памяти; более длинное - в std::string.
+class UpperName
+{
+private:
+    static constexpr std::size_t inline_size = 32;
 
-        std::string action_lower = action;
-        for (auto& c : action_lower) c = tolower(c);
+    char buffer[inline_size];
+    std::string long_name;
+    std::string_view text;
 
-        try
+public:
+    explicit UpperName(std::string_view name)
+    {
+        char *out = buffer;
+        if (name.size() > inline_size)
         {
-            if (action_lower == "new")
+            long_name.resize(name.size());
+            out = long_name.data();
+        }
+        for (std::size_t i = 0; i < name.size(); i++) out[i] = ascii_upper(name[i]);
+        text = std::string_view(out, name.size());
+    }
+
+    UpperName(const UpperName&) = delete;
+    UpperName& operator=(const UpperName&) = delete;
+
+    operator std::string_view() const
+    {
+        return text;
+    }
+};
+
+std::ostream& operator<<(std::ostream& out, const UpperName& name)
+{
+    return out << std::string_view(name);
+}
+
+std::string to_upper(std::string_view text)
+{
+    std::string result(text);
+    for (auto& c : result) c = ascii_upper(c);
+    return result;
+}
+
+void print_menu(std::ostream& out)
+{
+    out << "1.  new A               - добавить новое множество A (имя: буквы, цифры, '_')\n";
+    out << "2.  del A               - удалить множество A\n";
+    out << "3.  add A x             - добавить элемент x к множеству A\n";
+    out << "4.  rem A x             - убрать элемент x из множества A\n";
+    out << "5.  pow A [gray] [par N] - вычислить булеан множества A (gray - в порядке кода Грея,\n";
+    out << "                           par N - параллельно в N потоков)\n";
+    out << "6.  see [A]             - вывести множество A или все множества\n";
+    out << "7.  A + B               - объединение множеств A и B\n";
+    out << "8.  A & B               - пересечение множеств A и B\n";
+    out << "9.  A - B               - разность множеств A и B\n";
+    out << "10. A ^ B               - симметрическая разность множеств A и B\n";
+    out << "11. A < B               - проверить, является ли A подмножеством B\n";
+    out << "12. A = B               - проверить, равны ли множества A и B\n";
+    out << "13. (A + B) & (C - D)   - составное выражение: & выполняется раньше +, - и ^\n";
+    out << "14. comp A B            - дополнение A до универсума B (B \\ A)\n";
+    out << "15. comp A x y          - дополнение A до диапазона символов x..y\n";
+    out << "16. prod A B            - декартово произведение A × B\n";
+    out << "17. stat A B            - мощности A ∪ B, A ∩ B, A \\ B, A △ B и сходство A и B\n";
+    out << "18. union A B C ...     - объединение любого числа множеств за один проход\n";
+    out << "19. inter A B C ...     - пересечение любого числа множеств за один проход\n";
+    out << "20. sub A               - все множества, содержащиеся в A\n";
+    out << "21. sup A               - все множества, содержащие A\n";
+    out << "22. lattice             - диаграмма включений, максимальные и минимальные множества\n";
+    out << "23. save file           - сохранить все множества в снимок\n";
+    out << "24. load file           - открыть снимок (данные копируются при изменении)\n";
+    out << "25. dup                 - найти одинаковые множества\n";
+    out << "26. undo / redo         - отменить последнюю операцию / выполнить отменённую снова\n";
+    out << "27. compact             - сжать журнал (--journal файл) в снимок\n";
+    out << "28. exit                - выход\n";
+}
+
+void print_names(std::ostream& out, const std::vector<Set*>& sets)
+{
+    for (std::size_t i = 0; i < sets.size(); i++)
+    {
+        if (i != 0) out << ", ";
+        out << sets[i]->get_name();
+    }
+}
+
+// Выполняет одну команду. Возвращает false по команде exit.
+bool execute_command(std::string_view line, std::ostream& out, const ReplOptions& options)
+{
+    CommandLine cmd(line);
+    if (cmd.count == 0) return true;
+
+    std::string_view action = cmd[0];
+    // Имя множества может совпадать с командой (new sub): если за первым словом идёт
+    // знак операции, строка - выражение над множествами, а не команда.
+    Command command = cmd.count >= 3 && is_operator(cmd[1]) ? Command::none : command_of(action);
+
+    try
+    {
+        switch (command)
+        {
+        case Command::create:
+        {
+            UpperName name(cmd[1]);
+
+            options.journal->create(std::string(name));
+            if (!options.quiet) out << "Множество " << name << " создано\n";
+            break;
+        }
+        case Command::drop:
+        {
+            UpperName set_name(cmd[1]);
+
+            Set* set = Set::find_set(set_name);
+            if (set == nullptr)
             {
-                char name;
-                ss >> name;
-                name = toupper(name);
+                out << "Ошибка: множество " << set_name << " не существует\n";
+                return true;
+            }
+
+            options.journal->drop(*set);
+            if (!options.quiet) out << "Множество " << set_name << " удалено\n";
+            break;
+        }
+        case Command::add:
+        {
+            UpperName set_name(cmd[1]);
 
-                new Set(name);
-                std::cout << "Множество " << name << " создано\n";
+            Set* set = Set::find_set(set_name);
+            if (set == nullptr)
+            {
+                out << "Ошибка: множество " << set_name << " не существует\n";
+                return true;
             }
-            else if (action_lower == "del")
+            if (cmd[2].empty())
             {
-                char set_name;
-                ss >> set_name;
-                set_name = toupper(set_name);
+                out << "Ошибка: не указан элемент\n";
+                return true;
+            }
+            char element = cmd[2][0];
 
-                Set* set = Set::find_set(set_name);
-                if (set == nullptr)
-                {
-                    std::cout << "Ошибка: множество " << set_name << " не существует\n";
-                    continue;
-                }
+            if (options.journal->add(*set, element) == SetStatus::ok)
+            {
+                if (!options.quiet) out << "Элемент '" << element << "' добавлен в множество " << set_name << "\n";
+            }
+            else
+            {
+                out << "Ошибка добавления: элемент '" << element << "' уже существует в множестве " << set_name << "\n";
+            }
+            break;
+        }
+        case Command::remove:
+        {
+            UpperName set_name(cmd[1]);
 
-                delete set;
-                std::cout << "Множество " << set_name << " удалено\n";
+            Set* set = Set::find_set(set_name);
+            if (set == nullptr)
+            {
+                out << "Ошибка: множество " << set_name << " не существует\n";
+                return true;
             }
-            else if (action_lower == "add")
+            if (cmd[2].empty())
             {
-                char set_name, element;
-                ss >> set_name >> element;
-                set_name = toupper(set_name);
+                out << "Ошибка: не указан элемент\n";
+                return true;
+            }
+            char element = cmd[2][0];
 
+            if (options.journal->remove(*set, element) == SetStatus::ok)
+            {
+                if (!options.quiet) out << "Элемент '" << element << "' удалён из множества " << set_name << "\n";
+            }
+            else
+            {
+                out << "Ошибка удаления: элемент '" << element << "' не существует в множестве " << set_name << "\n";
+            }
+            break;
+        }
+        case Command::see:
+        {
+            if (cmd.count > 1)
+            {
+                UpperName set_name(cmd[1]);
                 Set* set = Set::find_set(set_name);
                 if (set == nullptr)
                 {
-                    std::cout << "Ошибка: множество " << set_name << " не существует\n";
-                    continue;
+                    out << "Ошибка: множество " << set_name << " не существует\n";
+                    return true;
                 }
+                set->see(set_name, out);
+            }
+            else
+            {
+                Set::see(out);
+            }
+            break;
+        }
+        case Command::pow:
+        {
+            UpperName set_name(cmd[1]);
 
-                try
-                {
-                    set->add(element);
-                    std::cout << "Элемент '" << element << "' добавлен в множество " << set_name << "\n";
-                }
-                catch (const std::exception& e)
+            Set* set = Set::find_set(set_name);
+            if (set == nullptr)
+            {
+                out << "Ошибка: множество " << set_name << " не существует\n";
+                return true;
+            }
+
+            bool gray = false;
+            bool parallel = false;
+            ParallelOptions parallel_options;
+            for (std::size_t i = 2; i < cmd.count; i++)
+            {
+                if (equals_ci(cmd[i], "gray")) gray = true;
+                else if (equals_ci(cmd[i], "par"))
                 {
-                    std::cout << "Ошибка добавления: элемент '" << element << "' уже существует в множестве " << set_name << "\n";
+                    parallel = true;
+                    unsigned threads;
+                    std::string_view arg = cmd[i + 1];
+                    if (std::from_chars(arg.data(), arg.data() + arg.size(), threads).ec == std::errc{})
+                    {
+                        parallel_options.threads = threads;
+                        i++;
+                    }
                 }
             }
-            else if (action_lower == "rem")
+
+            if (parallel) set->pow_parallel(out, parallel_options, gray);
+            else set->pow(out, gray);
+            break;
+        }
+        case Command::unite:
+        case Command::intersect:
+        {
+            bool unite = command == Command::unite;
+            if (cmd.truncated)
             {
-                char set_name, element;
-                ss >> set_name >> element;
-                set_name = toupper(set_name);
+                out << "Ошибка: слишком много множеств (не больше " << CommandLine::max_tokens - 1 << ")\n";
+                return true;
+            }
+            if (cmd.count < 2)
+            {
+                out << "Ошибка: не указаны множества\n";
+                return true;
+            }
 
-                Set* set = Set::find_set(set_name);
+            std::vector<const Set*> sets;
+            std::string formula;
+            for (std::size_t i = 1; i < cmd.count; i++)
+            {
+                UpperName set_name(cmd[i]);
+                const Set* set = Set::find_set(set_name);
                 if (set == nullptr)
                 {
-                    std::cout << "Ошибка: множество " << set_name << " не существует\n";
-                    continue;
+                    out << "Ошибка: множество " << set_name << " не существует\n";
+                    return true;
                 }
+                sets.push_back(set);
+                if (i > 1) formula += unite ? " ∪ " : " ∩ ";
+                formula += set_name;
+            }
 
-                try
-                {
-                    set->rem(element);
-                    std::cout << "Элемент '" << element << "' удалён из множества " << set_name << "\n";
-                }
-                catch (const std::exception& e)
-                {
-                    std::cout << "Ошибка удаления: элемент '" << element << "' не существует в множестве " << set_name << "\n";
-                }
+            Set* result = journaled(unite ? Set::union_all(sets) : Set::intersect_all(sets), options);
+            out << "Создано новое множество " << result->get_name() << " = " << formula << "\n";
+            result->see(result->get_name(), out);
+            break;
+        }
+        case Command::complement:
+        {
+            UpperName set_name(cmd[1]);
+            Set* set = Set::find_set(set_name);
+            if (set == nullptr)
+            {
+                out << "Ошибка: множество " << set_name << " не существует\n";
+                return true;
             }
-            else if (action_lower == "see")
+
+            Set* result;
+            std::string formula;
+            if (cmd.count == 4)
             {
-                char set_name;
-                if (ss >> set_name)
+                if (cmd[2].size() != 1 || cmd[3].size() != 1)
                 {
-                    set_name = toupper(set_name);
-                    Set* set = Set::find_set(set_name);
-                    if (set == nullptr)
-                    {
-                        std::cout << "Ошибка: множество " << set_name << " не существует\n";
-                        continue;
-                    }
-                    set->see(set_name);
+                    out << "Ошибка: границы диапазона - одиночные символы\n";
+                    return true;
                 }
-                else
+                char first = cmd[2][0], last = cmd[3][0];
+                result = journaled(set->complement(first, last), options);
+                formula = "['" + std::string(1, first) + "'..'" + std::string(1, last) + "'] \\ ";
+                formula += set_name;
+            }
+            else
+            {
+                UpperName universe_name(cmd[2]);
+                Set* universe = Set::find_set(universe_name);
+                if (universe == nullptr)
                 {
-                    Set::see();
+                    out << "Ошибка: множество " << universe_name << " не существует\n";
+                    return true;
                 }
+                result = journaled(set->complement_in(*universe), options);
+                formula = std::string(universe_name) + " \\ ";
+                formula += set_name;
+            }
+            out << "Создано новое множество " << result->get_name() << " = " << formula << "\n";
+            result->see(result->get_name(), out);
+            break;
+        }
+        case Command::product:
+        {
+            UpperName set1_name(cmd[1]);
+            UpperName set2_name(cmd[2]);
+            Set* set1 = Set::find_set(set1_name);
+            Set* set2 = Set::find_set(set2_name);
+            if (set1 == nullptr || set2 == nullptr)
+            {
+                out << "Ошибка: одно или оба множества не существуют\n";
+                return true;
             }
-            else if (action_lower == "pow")
+
+            out << set1_name << " × " << set2_name << " = {";
+            std::size_t count = 0;
+            set1->for_each_pair(*set2, [&](char a, char b)
+            {
+                if (count++ != 0) out << ", ";
+                out << "(" << a << ", " << b << ")";
+            });
+            out << "}\nПар: " << count << "\n";
+            break;
+        }
+        case Command::stat:
+        {
+            UpperName set1_name(cmd[1]);
+            UpperName set2_name(cmd[2]);
+            Set* set1 = Set::find_set(set1_name);
+            Set* set2 = Set::find_set(set2_name);
+            if (set1 == nullptr || set2 == nullptr)
             {
-                char set_name;
-                ss >> set_name;
-                set_name = toupper(set_name);
+                out << "Ошибка: одно или оба множества не существуют\n";
+                return true;
+            }
 
-                Set* set = Set::find_set(set_name);
-                if (set == nullptr)
-                {
-                    std::cout << "Ошибка: множество " << set_name << " не существует\n";
-                    continue;
-                }
+            std::size_t common = set1->intersection_size(*set2);
+            std::size_t size1 = set1->size(), size2 = set2->size();
+            out << "|" << set1_name << "| = " << size1 << ", |" << set2_name << "| = " << size2 << "\n";
+            out << "|" << set1_name << " ∪ " << set2_name << "| = " << size1 + size2 - common
+                << ", |" << set1_name << " ∩ " << set2_name << "| = " << common
+                << ", |" << set1_name << " \\ " << set2_name << "| = " << size1 - common
+                << ", |" << set2_name << " \\ " << set1_name << "| = " << size2 - common
+                << ", |" << set1_name << " △ " << set2_name << "| = " << size1 + size2 - 2 * common << "\n";
+            out << "Коэффициент Жаккара: " << set1->jaccard(*set2)
+                << ", коэффициент перекрытия: " << set1->overlap(*set2) << "\n";
+            break;
+        }
+        case Command::subsets:
+        case Command::supersets:
+        {
+            bool subsets = command == Command::subsets;
+            UpperName set_name(cmd[1]);
 
-                set->pow();
+            auto guard = Set::read_guard();
+            Set* set = Set::find_set(set_name);
+            if (set == nullptr)
+            {
+                out << "Ошибка: множество " << set_name << " не существует\n";
+                return true;
             }
-            else if (action_lower == "help")
+
+            std::vector<Set*> found = subsets ? Set::subsets_of(*set) : Set::supersets_of(*set);
+            if (found.empty())
             {
-                print_menu();
+                out << (subsets ? "Подмножеств " : "Надмножеств ") << set_name << " нет\n";
+                return true;
             }
-            else if (action_lower == "exit")
+            out << (subsets ? "Подмножества " : "Надмножества ") << set_name << ": ";
+            print_names(out, found);
+            out << "\n";
+            break;
+        }
+        case Command::lattice:
+        {
+            auto guard = Set::read_guard();
+            SubsetIndex<Set> index = Set::subset_index();
+            if (index.size() == 0)
             {
-                std::cout << "Выход из программы\n";
-                break;
+                out << "Не создано ни одного множества\n";
+                return true;
             }
 
-            else if (action.length() == 1 && action[0] >= 'A' && action[0] <= 'Z')
+            auto covers = index.covers();
+            if (covers.empty())
             {
-                char set1_name = toupper(action[0]);
-                std::string operation;
-                char set2_name;
-
-                ss >> operation >> set2_name;
-                set2_name = toupper(set2_name);
+                out << "Строгих включений нет\n";
+            }
+            for (const auto& [lower, upper] : covers)
+            {
+                out << lower->get_name() << " ⊂ " << upper->get_name() << "\n";
+            }
+            out << "Максимальные: ";
+            print_names(out, index.maximal());
+            out << "\nМинимальные: ";
+            print_names(out, index.minimal());
+            out << "\n";
+            break;
+        }
+        case Command::save:
+        {
+            std::string path(cmd[1]);
+            Set::save_snapshot(path);
+            out << "Множества сохранены в снимок " << path << "\n";
+            break;
+        }
+        case Command::load:
+        {
+            std::string path(cmd[1]);
+            std::vector<Set*> loaded;
+            std::size_t count = Set::load_snapshot(path, &loaded);
+            for (Set* set : loaded) journaled(set, options);
+            out << "Загружено множеств: " << count << " из снимка " << path << "\n";
+            break;
+        }
+        case Command::duplicates:
+        {
+            auto groups = Set::duplicates();
+            if (groups.empty())
+            {
+                out << "Одинаковых множеств нет\n";
+            }
+            for (const auto& group : groups)
+            {
+                out << "Одинаковые множества: ";
+                for (std::size_t i = 0; i < group.size(); i++)
+                {
+                    if (i != 0) out << " = ";
+                    out << group[i]->get_name();
+                }
+                out << "\n";
+            }
+            break;
+        }
+        case Command::undo:
+        {
+            out << (options.journal->undo() ? "Последняя операция отменена\n" : "Нечего отменять\n");
+            break;
+        }
+        case Command::redo:
+        {
+            out << (options.journal->redo() ? "Отменённая операция выполнена снова\n" : "Нечего повторять\n");
+            break;
+        }
+        case Command::compact:
+        {
+            options.journal->compact();
+            out << "Журнал сжат в снимок\n";
+            break;
+        }
+        case Command::help:
+        {
+            print_menu(out);
+            break;
+        }
+        case Command::exit:
+        {
+            out << "Выход из программы\n";
+            return false;
+        }
+        default:
+            if (Set::is_valid_name(action) && cmd.count <= 3)
+            {
+                UpperName set1_name(action);
+                std::string_view operation = cmd[1];
+                UpperName set2_name(cmd[2]);
 
                 Set* set1 = Set::find_set(set1_name);
                 Set* set2 = Set::find_set(set2_name);
 
                 if (set1 == nullptr || set2 == nullptr)
                 {
-                    std::cout << "Ошибка: одно или оба множества не существуют\n";
-                    continue;
+                    out << "Ошибка: одно или оба множества не существуют\n";
+                    return true;
                 }
 
                 if (operation == "+")
                 {
-                    Set* result = set1->union_merge(*set2);
-                    std::cout << "Создано новое множество " << result->get_name() << " = "
-                              << set1_name << " ∪ " << set2_name << "\n";
-                    result->see(result->get_name());
+                    Set* result = journaled(set1->union_merge(*set2), options);
+                    out << "Создано новое множество " << result->get_name() << " = "
+                        << set1_name << " ∪ " << set2_name << "\n";
+                    result->see(result->get_name(), out);
                 }
                 else if (operation == "&")
                 {
-                    Set* result = set1->intersection_merge(*set2);
-                    std::cout << "Создано новое множество " << result->get_name() << " = "
-                              << set1_name << " ∩ " << set2_name << "\n";
-                    result->see(result->get_name());
+                    Set* result = journaled(set1->intersection_merge(*set2), options);
+                    out << "Создано новое множество " << result->get_name() << " = "
+                        << set1_name << " ∩ " << set2_name << "\n";
+                    result->see(result->get_name(), out);
                 }
                 else if (operation == "-")
                 {
-                    Set* result = set1->difference_merge(*set2);
-                    std::cout << "Создано новое множество " << result->get_name() << " = "
-                              << set1_name << " \\ " << set2_name << "\n";
-                    result->see(result->get_name());
+                    Set* result = journaled(set1->difference_merge(*set2), options);
+                    out << "Создано новое множество " << result->get_name() << " = "
+                        << set1_name << " \\ " << set2_name << "\n";
+                    result->see(result->get_name(), out);
+                }
+                else if (operation == "^")
+                {
+                    Set* result = journaled(set1->symmetric_difference_merge(*set2), options);
+                    out << "Создано новое множество " << result->get_name() << " = "
+                        << set1_name << " △ " << set2_name << "\n";
+                    result->see(result->get_name(), out);
                 }
                 else if (operation == "<")
                 {
                     if (*set1 < *set2)
                     {
-                        std::cout << set1_name << " ⊂ " << set2_name << " (истина)\n";
+                        out << set1_name << " ⊂ " << set2_name << " (истина)\n";
                     }
                     else if (*set1 <= *set2)
                     {
-                        std::cout << set1_name << " ⊆ " << set2_name << " (истина, множества равны)\n";
+                        out << set1_name << " ⊆ " << set2_name << " (истина, множества равны)\n";
                     }
                     else
                     {
-                        std::cout << set1_name << " ⊄ " << set2_name << " (ложь)\n";
+                        out << set1_name << " ⊄ " << set2_name << " (ложь)\n";
                     }
                 }
                 else if (operation == "=")
                 {
                     if (*set1 == *set2)
                     {
-                        std::cout << set1_name << " = " << set2_name << " (истина)\n";
+                        out << set1_name << " = " << set2_name << " (истина)\n";
                     }
                     else
                     {
-                        std::cout << set1_name << " ≠ " << set2_name << " (ложь)\n";
+                        out << set1_name << " ≠ " << set2_name << " (ложь)\n";
                     }
                 }
                 else
                 {
-                    std::cout << "Неизвестная операция. Используйте +, &, -, <, =\n";
+                    out << "Неизвестная операция. Используйте +, &, -, ^, <, =\n";
                 }
             }
+            else if (line.find_first_of("()+&-^") != std::string_view::npos)
+            {
+                SetExpression expr = SetExpression::parse(to_upper(line));
+                Set* result = journaled(Set::evaluate(expr), options);
+                out << "Создано новое множество " << result->get_name() << " = " << expr.to_string() << "\n";
+                result->see(result->get_name(), out);
+            }
             else
             {
-                std::cout << "Неизвестная команда. Введите help для справки\n";
+                out << "Неизвестная команда. Введите help для справки\n";
             }
+            break;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        out << "Ошибка: " << e.what() << "\n";
+    }
+
+    return true;
+}
+
+// Сжатие журнала по счётчику записей - между командами: его ошибка не относится
+// к уже выполненной команде и печатается отдельно.
+void compact_journal_if_due(std::ostream& out, const ReplOptions& options)
+{
+    try
+    {
+        options.journal->compact_if_due();
+    }
+    catch (const std::exception& e)
+    {
+        out << "Ошибка сжатия журнала: " << e.what() << "\n";
+    }
+}
+
+// Пакетный режим: файл сценария читается целиком одним read,
+// строки разбираются прямо в буфере.
+void run_script(const char *path, std::ostream& out, const ReplOptions& options)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        throw std::runtime_error(std::string("не удалось открыть файл ") + path);
+    }
+
+    std::string script(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(script.data(), static_cast<std::streamsize>(script.size()));
+
+    std::string_view rest = script;
+    while (!rest.empty())
+    {
+        std::size_t end = rest.find('\n');
+        std::string_view line = rest.substr(0, end);
+        rest = end == std::string_view::npos ? std::string_view{} : rest.substr(end + 1);
+
+        if (!execute_command(line, out, options)) break;
+        compact_journal_if_due(out, options);
+    }
+}
+
+// журнал сжимается в снимок после стольких записей
+constexpr std::size_t journal_compact_every = 100000;
+
+// 1task [сценарий] [--quiet] [--journal файл]
+int main(int argc, char* argv[])
+{
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+    SetConsoleCP(CP_UTF8);
+#endif
+
+    BufferedWriter writer(stdout);
+    std::ostream out(&writer);
+
+    SetJournal<Set> journal;
+    ReplOptions options;
+    options.journal = &journal;
+    const char *script = nullptr;
+    const char *journal_path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--quiet") == 0 || std::strcmp(argv[i], "-q") == 0) options.quiet = true;
+        else if (std::strcmp(argv[i], "--journal") == 0 && i + 1 < argc) journal_path = argv[++i];
+        else script = argv[i];
+    }
+
+    if (journal_path != nullptr)
+    {
+        try
+        {
+            std::size_t replayed = journal.open(journal_path, journal_compact_every);
+            if (!options.quiet) out << "Журнал " << journal_path << ": повторено операций: " << replayed << "\n";
         }
         catch (const std::exception& e)
         {
-            std::cout << "Ошибка: " << e.what() << "\n";
+            out.flush();
+            std::cerr << "Ошибка: " << e.what() << "\n";
+            return 1;
         }
     }
 
+    if (script != nullptr)
+    {
+        try
+        {
+            run_script(script, out, options);
+            journal.flush();
+        }
+        catch (const std::exception& e)
+        {
+            out.flush();
+            std::cerr << "Ошибка: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    std::string command;
+
+    while (true)
+    {
+        out << "\n> ";
+        out.flush();
+        if (!std::getline(std::cin, command)) break;
+
+        bool running = execute_command(command, out, options);
+        compact_journal_if_due(out, options);
+        try
+        {
+            journal.flush();
+        }
+        catch (const std::exception& e)
+        {
+            out << "Ошибка: " << e.what() << "\n";
+        }
+        if (!running) break;
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,473 +1,1338 @@
 #ifndef DISCRETE_MATHEMATICS_1TASK_H
 #define DISCRETE_MATHEMATICS_1TASK_H
 
+#include <array>
+#include <concepts>
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <algorithm>
-
-struct Node
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+#include "parallel_power_set.h"
+#include "power_set.h"
+#include "roaring_storage.h"
+#include "set_pool.h"
+#include "set_expression.h"
+#include "set_journal.h"
+#include "set_reclaim.h"
+#include "set_registry.h"
+#include "set_sketch.h"
+#include "set_storage.h"
+#include "snapshot.h"
+#include "subset_index.h"
+
+// Результат try_add / try_remove: частые исходы горячих команд возвращаются кодом,
+// без исключения и раскрутки стека.
+enum class SetStatus : uint8_t
 {
-    char data;
-    Node *next;
-
-    Node(char value) : data(value), next(nullptr) {}
+    ok,
+    already_exists,  // try_add: элемент уже есть
+    not_found,       // try_remove: элемента нет (в том числе множество пустое)
+    not_initialized  // множество не создано
 };
 
-class Set
+// Множество элементов типа T с политикой хранения Storage (см. set_storage.h).
+// Имя множества и реестр всех созданных множеств (set_registry.h) общие для всех политик.
+// Потокобезопасность: реестр допускает одновременные поиск, создание и удаление
+// множеств; читатели держат read_guard, пока работают с найденными множествами,
+// а удаление через retire откладывает освобождение до их ухода (set_reclaim.h).
+// Изменение одного множества (add/rem) одновременно с его чтением не синхронизируется.
+template <typename T, typename Storage>
+class BasicSet
 {
 private:
-    Node *head;
-    static std::vector<Set*> all_sets;
+    std::string name;
+    bool initialized;
+    Storage storage;
+    static SetRegistry<BasicSet> registry;
+
+    // Мощность и хеш содержимого (сумма хешей элементов, не зависит от порядка).
+    // add/rem обновляют их за O(1); множество, собранное целиком (слияние, выражение,
+    // снимок), считает их лениво при первом обращении. Атомарны, потому что ленивый
+    // подсчёт может идти одновременно из нескольких читающих потоков; add/rem пишут
+    // без атомарных read-modify-write - изменение множества и так однопоточно.
+    mutable std::atomic<std::size_t> cached_size{0};
+    mutable std::atomic<uint64_t> content_hash{0};
+    mutable std::atomic<bool> summary_valid{true};
 
 public:
-    Set() : head(nullptr) {}
+    using value_type = T;
+
+    static constexpr std::size_t signature_words = 4;
+    using Signature = std::array<uint64_t, signature_words>;
+
+private:
+    // Сигнатура для фильтра включений (subset_index.h): по биту на элемент, номер бита -
+    // старшие биты хеша элемента. add дописывает бит; rem снять бит не может (его могли
+    // поставить и другие элементы), поэтому после rem сигнатура считается заново при
+    // следующем обращении.
+    mutable std::array<std::atomic<uint64_t>, signature_words> signature_bits{};
+    mutable std::atomic<bool> signature_valid{true};
+
+    // Необязательные сводки HyperLogLog и MinHash (set_sketch.h) для приближённых
+    // ответов о больших множествах без обхода элементов. Включаются enable_sketch();
+    // add дописывает элемент в сводку, rem помечает её устаревшей, и она строится
+    // заново при следующем запросе. Перестройку могут начать несколько читающих
+    // потоков сразу, поэтому она идёт под sketch_mutex.
+    std::unique_ptr<SetSketch> sketch;
+    mutable std::atomic<bool> sketch_valid{false};
+    mutable std::mutex sketch_mutex;
+
+    static auto& pool()
+    {
+        static SlabPool<sizeof(BasicSet), alignof(BasicSet)> instance;
+        return instance;
+    }
+
+    static auto& reclaimer()
+    {
+        static EpochReclaimer<BasicSet> instance;
+        return instance;
+    }
+
+    // Индекс включений реестра (subset_index.h) строится при первом запросе и служит,
+    // пока ничего не изменилось: add/rem и регистрация множества сбрасывают флаг
+    // subset_index_fresh, и следующий запрос строит индекс заново. Удаление из реестра
+    // ещё и выбрасывает индекс под мьютексом: запрос, который идёт по старому индексу,
+    // закончится раньше, чем множество уйдёт в reclaimer.
+    struct SubsetIndexCache
+    {
+        std::mutex mutex;
+        std::optional<SubsetIndex<BasicSet>> index;
+    };
+
+    static std::atomic<bool>& subset_index_fresh()
+    {
+        static std::atomic<bool> fresh{false};
+        return fresh;
+    }
 
-    ~Set()
+    // не разрушается при выходе: множества со статическим временем жизни удаляются позже
+    static SubsetIndexCache& subset_cache()
     {
-        Node *curr_iter = head;
-        while (curr_iter)
+        static SubsetIndexCache *instance = new SubsetIndexCache();
+        return *instance;
+    }
+
+    // на горячем пути add/rem - только чтение флага, пока индекс не построен
+    static void invalidate_subset_index()
+    {
+        std::atomic<bool>& fresh = subset_index_fresh();
+        if (fresh.load(std::memory_order_relaxed)) fresh.store(false, std::memory_order_relaxed);
+    }
+
+    // всегда под мьютексом: индекс, который строится прямо сейчас, мог застать множество в реестре
+    static void drop_subset_index()
+    {
+        std::lock_guard<std::mutex> lock(subset_cache().mutex);
+        subset_index_fresh().store(false, std::memory_order_relaxed);
+        subset_cache().index.reset();
+    }
+
+public:
+    // объекты множеств берутся из пула: результаты слияний создаются и удаляются без malloc
+    static void *operator new(std::size_t size)
+    {
+        return size == sizeof(BasicSet) ? pool().allocate() : ::operator new(size);
+    }
+
+    static void operator delete(void *ptr, std::size_t size)
+    {
+        if (size == sizeof(BasicSet))
         {
-            Node *next = curr_iter->next;
-            delete curr_iter;
-            curr_iter = next;
+            pool().deallocate(ptr);
+            return;
         }
+        ::operator delete(ptr);
+    }
 
-        auto it = std::find(all_sets.begin(), all_sets.end(), this);
-        if (it != all_sets.end())
+public:
+    BasicSet() : initialized(false) {}
+
+    ~BasicSet()
+    {
+        if (initialized)
         {
-            all_sets.erase(it);
+            registry.erase(name, this);
+            drop_subset_index();
         }
     }
 
-    Set(char name)
+    BasicSet(const std::string& name) : name(name), initialized(false)
+    {
+        require_valid_name(name);
+
+        initialized = true;
+        registry.insert(name, this);
+        invalidate_subset_index();
+    }
+
+    BasicSet(char name) : BasicSet(std::string(1, name)) {}
+
+public:
+    const std::string& get_name() const
     {
-        if (name < 'A' || name > 'Z')
+        if (!initialized)
         {
-            throw std::invalid_argument("имя множества должно быть в диапозоне [A, Z]");
+            throw std::logic_error("множество не инициализировано");
         }
+        return name;
+    }
+
+public:
+    static BasicSet *find_set(std::string_view name)
+    {
+        return registry.find(name);
+    }
+
+    static BasicSet *find_set(char name)
+    {
+        return registry.find(std::string_view(&name, 1));
+    }
+
+    static bool is_valid_name(std::string_view name)
+    {
+        return SetRegistry<BasicSet>::is_valid_name(name);
+    }
 
-        Set *set = find_set(name);
-        if (set != nullptr)
+private:
+    static void require_valid_name(const std::string& name)
+    {
+        if (!is_valid_name(name))
         {
-            throw std::logic_error("множество уже существует");
+            throw std::invalid_argument("имя множества должно начинаться с буквы и состоять из букв, цифр и '_'");
         }
+    }
 
-        head = new Node(name);
-        all_sets.push_back(this);
+    // Регистрирует заполненное множество: до этого момента его не видит ни один поток.
+    static BasicSet* publish(std::unique_ptr<BasicSet> set)
+    {
+        set->summary_valid.store(false, std::memory_order_relaxed);
+        set->signature_valid.store(false, std::memory_order_relaxed);
+        registry.insert_unnamed(set.get(), [&set](std::string free_name)
+        {
+            set->name = std::move(free_name);
+            set->initialized = true;
+        });
+        invalidate_subset_index();
+        return set.release();
+    }
+
+    static BasicSet* publish(std::unique_ptr<BasicSet> set, const std::string& name)
+    {
+        require_valid_name(name);
+        set->summary_valid.store(false, std::memory_order_relaxed);
+        set->signature_valid.store(false, std::memory_order_relaxed);
+        set->name = name;
+        set->initialized = true;
+        registry.insert(name, set.get());
+        invalidate_subset_index();
+        return set.release();
     }
 
 public:
-    char get_name() const
+    // Пока жив guard, множества, найденные через find_set, не будут освобождены,
+    // даже если другой поток их удалит. Guard дешёвый и допускает вложение.
+    static typename EpochReclaimer<BasicSet>::Guard read_guard()
+    {
+        return typename EpochReclaimer<BasicSet>::Guard(reclaimer());
+    }
+
+    // Удаляет множество из реестра сразу, а память освобождает, когда закончатся
+    // все read_guard, начатые до удаления. Для множества из new вместо delete.
+    static void retire(BasicSet* set)
     {
-        if (head == nullptr)
+        if (set->initialized)
         {
-            throw std::logic_error("множество не инициализировано");
+            registry.erase(set->name, set);
+            drop_subset_index();
         }
-        return head->data;
+        reclaimer().retire(set, [](void *ptr) { delete static_cast<BasicSet*>(ptr); });
     }
 
 public:
-    static Set *find_set(char name)
+    // Построение множества из строго возрастающей последовательности за один проход:
+    // элементы дописываются в хвост хранилища без поиска места и проверки повторов.
+    template <typename It>
+    static BasicSet* from_sorted_range(const std::string& name, It first, It last)
     {
-        for (Set *set : all_sets)
+        std::unique_ptr<BasicSet> result(new BasicSet());
+        result->assign_sorted(first, last);
+        return publish(std::move(result), name);
+    }
+
+    template <typename It>
+    static BasicSet* from_sorted_range(It first, It last)
+    {
+        std::unique_ptr<BasicSet> result(new BasicSet());
+        result->assign_sorted(first, last);
+        return publish(std::move(result));
+    }
+
+private:
+    template <typename It>
+    void assign_sorted(It first, It last)
+    {
+        storage.clear();
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                        typename std::iterator_traits<It>::iterator_category>)
         {
-            if (set->head->data == name)
+            storage.reserve(static_cast<std::size_t>(std::distance(first, last)));
+        }
+
+        bool has_prev = false;
+        T prev{};
+        for (; first != last; ++first)
+        {
+            const T& value = *first;
+            if (has_prev && !(prev < value))
             {
-                return set;
+                storage.clear();
+                throw std::invalid_argument("последовательность должна строго возрастать");
             }
+            storage.append_sorted(value);
+            prev = value;
+            has_prev = true;
+        }
+        if constexpr (requires { storage.optimize(); })
+        {
+            storage.optimize();
         }
-        return nullptr;
     }
 
 public:
-    bool contains(char value) const
+    bool contains(const T& value) const
     {
-        if (head == nullptr)
+        if (!initialized)
         {
             return false;
         }
+        return storage.contains(value);
+    }
 
-        Node *curr_iter = head->next;
-        while (curr_iter != nullptr)
-        {
-            if (curr_iter->data == value)
-            {
-                return true;
-            }
-            curr_iter = curr_iter->next;
-        }
-        return false;
+public:
+    // Добавление без исключений для частых исходов: повтор элемента возвращает
+    // SetStatus::already_exists. Исключение остаётся только для элемента вне
+    // универсума хранилища (отрицательный элемент битовой карты) и нехватки памяти.
+    SetStatus try_add(const T& value)
+    {
+        if (!initialized) return SetStatus::not_initialized;
+        if (!storage.insert(value)) return SetStatus::already_exists;
+        note_added(value);
+        return SetStatus::ok;
+    }
+
+    SetStatus try_remove(const T& value)
+    {
+        if (!initialized) return SetStatus::not_initialized;
+        if (!storage.erase(value)) return SetStatus::not_found;
+        note_removed(value);
+        return SetStatus::ok;
     }
 
 public:
-    void add(char value)
+    void add(const T& value)
     {
-        if (head == nullptr)
+        switch (try_add(value))
         {
+        case SetStatus::not_initialized:
             throw std::logic_error("сначала создайте множество");
+        case SetStatus::already_exists:
+            throw std::logic_error("элемент уже существует в множестве");
+        default:
+            break;
         }
+    }
 
-        if (contains(value))
+public:
+    void rem(const T& value)
+    {
+        if (!initialized)
         {
-            throw std::logic_error("элемент уже существует в множестве");
+            throw std::invalid_argument("сначала создайте множество");
         }
-
-        Node *new_node = new Node(value);
-        Node *prev_iter = nullptr;
-        Node *curr_iter  = head->next;
-        while (curr_iter != nullptr && value > curr_iter->data)
+        if (storage.empty())
         {
-            prev_iter = curr_iter;
-            curr_iter = curr_iter->next;
+            throw std::logic_error("множество пустое");
         }
-
-        if (prev_iter == nullptr)
+        if (try_remove(value) == SetStatus::not_found)
         {
-            new_node->next = head->next;
-            head->next = new_node;
-            return;
+            throw std::logic_error("элемент не существует в множестве");
         }
-        prev_iter->next = new_node;
-        new_node->next = curr_iter;
     }
 
 public:
-    void rem(char value)
+    // Вставка пачки с пропуском повторов (insert-or-ignore); возвращает число
+    // добавленных элементов. Отсортированный массив не вставляет элементы по одному
+    // (каждая вставка сдвигает хвост): пачка сортируется и сливается с массивом за
+    // один проход.
+    std::size_t add_all(std::span<const T> values)
     {
-        if (head == nullptr)
+        if (!initialized)
         {
-            throw std::invalid_argument("сначала создайте множество");
+            throw std::logic_error("сначала создайте множество");
         }
-        if (head->next == nullptr)
+
+        if constexpr (requires(const T& a, const T& b) { storage.items(); a < b; })
         {
-            throw std::logic_error("множество пустое");
+            if (values.size() >= bulk_merge_threshold)
+            {
+                std::vector<T> sorted(values.begin(), values.end());
+                std::sort(sorted.begin(), sorted.end());
+                sorted.erase(std::unique(sorted.begin(), sorted.end(),
+                                         [](const T& a, const T& b) { return !(a < b) && !(b < a); }),
+                             sorted.end());
+
+                Storage batch, merged;
+                batch.reserve(sorted.size());
+                for (const T& value : sorted) batch.append_sorted(value);
+                Storage::unite(storage, batch, merged);
+
+                std::size_t added = merged.size() - storage.size();
+                storage = std::move(merged);
+                if (added != 0)
+                {
+                    summary_valid.store(false, std::memory_order_relaxed);
+                    signature_valid.store(false, std::memory_order_relaxed);
+                    invalidate_subset_index();
+                    // повторное добавление в сводку ничего не меняет, поэтому в неё идёт вся пачка
+                    if (sketch && sketch_valid.load(std::memory_order_relaxed))
+                    {
+                        for (const T& value : sorted) sketch->add(element_hash(value));
+                    }
+                }
+                return added;
+            }
         }
 
-        if (!contains(value))
+        std::size_t added = 0;
+        for (const T& value : values)
         {
-            throw std::logic_error("элемент уже существует в множестве");
+            if (storage.insert(value))
+            {
+                note_added(value);
+                added++;
+            }
         }
+        return added;
+    }
 
-        Node *temp_ptr;
-        Node *curr_iter = head->next;
-        Node *prev_iter = head;
-        while(curr_iter != nullptr && curr_iter->data != value)
+private:
+    static constexpr std::size_t bulk_merge_threshold = 16;
+
+    // поддержка мощности, хеша содержимого, сигнатуры и сводки после изменения на один элемент
+    void note_added(const T& value)
+    {
+        uint64_t h = element_hash(value);
+        if (summary_valid.load(std::memory_order_relaxed))
+        {
+            cached_size.store(cached_size.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            content_hash.store(content_hash.load(std::memory_order_relaxed) + h, std::memory_order_relaxed);
+        }
+        if (signature_valid.load(std::memory_order_relaxed))
+        {
+            std::size_t bit = signature_bit(h);
+            std::atomic<uint64_t>& word = signature_bits[bit / 64];
+            word.store(word.load(std::memory_order_relaxed) | uint64_t{1} << (bit % 64), std::memory_order_relaxed);
+        }
+        if (sketch && sketch_valid.load(std::memory_order_relaxed))
         {
-            prev_iter = curr_iter;
-            curr_iter = curr_iter->next;
+            sketch->add(h);
         }
-        if (curr_iter != nullptr)
+        invalidate_subset_index();
+    }
+
+    void note_removed(const T& value)
+    {
+        if (summary_valid.load(std::memory_order_relaxed))
         {
-            prev_iter->next = curr_iter->next;
-            delete curr_iter;
+            cached_size.store(cached_size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+            content_hash.store(content_hash.load(std::memory_order_relaxed) - element_hash(value),
+                               std::memory_order_relaxed);
         }
+        signature_valid.store(false, std::memory_order_relaxed);
+        sketch_valid.store(false, std::memory_order_relaxed);
+        invalidate_subset_index();
     }
+
 public:
-    static void see()
+    // Обход элементов без выделения памяти: visitor(value) вызывается для каждого
+    // элемента. Битовая карта, отсортированный массив и roaring обходят элементы по
+    // возрастанию, хеш-таблица - в порядке слотов.
+    template <typename Visitor>
+    void for_each(Visitor visitor) const
+    {
+        storage.for_each([&visitor](const T& value) { visitor(value); });
+    }
+
+    // Выгрузка элементов в буфер вызывающего в порядке for_each; возвращает их число.
+    // Отсортированный массив копируется одним куском.
+    std::size_t copy_to(std::span<T> out) const
     {
-        if (all_sets.size() == 0)
+        std::size_t count = size();
+        if (out.size() < count)
         {
-            std::cout << "Не создано ни одного множества\n";
-            return;
+            throw std::length_error("буфер меньше множества");
+        }
+        if constexpr (requires { storage.items(); })
+        {
+            std::span<const T> items = storage.items();
+            std::copy(items.begin(), items.end(), out.begin());
         }
+        else
+        {
+            T *next = out.data();
+            storage.for_each([&next](const T& value) { *next++ = value; });
+        }
+        return count;
+    }
 
-        std::cout << "Список всех множеств:\n";
-        for (Set *set : all_sets)
+    // Выгрузка в битовую карту вызывающего: бит i слова i / 64 установлен, если в
+    // множестве есть элемент с беззнаковым значением i (для char - код символа).
+    // Остальные биты words обнуляются. У битовой карты слова копируются кусками.
+    void copy_to_bitmap(std::span<uint64_t> words) const
+        requires std::is_integral_v<T>
+    {
+        if constexpr (requires { storage.copy_words(words.data(), words.size()); })
+        {
+            if (storage.copy_words(words.data(), words.size())) return;
+        }
+        else
         {
-            printf("  %c: { ", set->head->data);
-            Node *iter = set->head->next;
-            bool first = true;
-            while (iter)
+            std::fill(words.begin(), words.end(), 0);
+            bool fits = true;
+            storage.for_each([&](const T& value)
             {
-                if (!first) printf(", ");
-                printf("%c", iter->data);
-                iter = iter->next;
-                first = false;
-            }
-            printf(" }\n");
+                auto i = static_cast<std::make_unsigned_t<T>>(value);
+                if (i / 64 < words.size()) words[i / 64] |= uint64_t{1} << (i % 64);
+                else fits = false;
+            });
+            if (fits) return;
         }
+        throw std::out_of_range("элемент множества не помещается в битовую карту");
     }
 
 public:
-    void see(char set_name) const
+    bool is_empty() const
     {
-        if (find_set(set_name) == nullptr)
-        {
-            throw std::invalid_argument("множество не существует");
-        }
+        return storage.empty();
+    }
 
-        printf("Элементы множества %c: { ", head->data);
-        Node *iter = head->next;
-        bool first = true;
-        while (iter)
+    std::size_t size() const
+    {
+        if (summary_valid.load(std::memory_order_acquire))
         {
-            if (!first) printf(", ");
-            printf("%c", iter->data);
-            iter = iter->next;
-            first = false;
+            return cached_size.load(std::memory_order_relaxed);
         }
-        printf(" }\n");
+        return storage.size();
     }
 
+    // хеш содержимого: у равных множеств он одинаковый при любой политике хранения
+    uint64_t hash() const
+    {
+        ensure_summary();
+        return content_hash.load(std::memory_order_relaxed);
+    }
 
-public:
-    void pow()
+    Signature signature() const
+    {
+        ensure_signature();
+        Signature result;
+        for (std::size_t i = 0; i < signature_words; i++) result[i] = signature_bits[i].load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    // хеш элемента, перемешанный финализатором splitmix64: std::hash для целых тождественен
+    static uint64_t element_hash(const T& value)
+    {
+        uint64_t x = static_cast<uint64_t>(std::hash<T>{}(value));
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    void ensure_summary() const
     {
-        std::vector<char> elements;
-        Node* current = head->next;
-        while (current)
+        if (summary_valid.load(std::memory_order_acquire)) return;
+
+        std::size_t count = 0;
+        uint64_t sum = 0;
+        storage.for_each([&count, &sum](const T& value)
         {
-            elements.push_back(current->data);
-            current = current->next;
-        }
+            count++;
+            sum += element_hash(value);
+        });
+        cached_size.store(count, std::memory_order_relaxed);
+        content_hash.store(sum, std::memory_order_relaxed);
+        summary_valid.store(true, std::memory_order_release);
+    }
 
-        int n = elements.size();
-        int total = 1 << n;
+    // номер бита сигнатуры по хешу элемента
+    static std::size_t signature_bit(uint64_t h)
+    {
+        return static_cast<std::size_t>(h >> 56) % (signature_words * 64);
+    }
 
-        std::cout << "булеан: " << head->data << ": {\n";
+    void ensure_signature() const
+    {
+        if (signature_valid.load(std::memory_order_acquire)) return;
 
-        for (int mask = 0; mask < total; mask++)
+        Signature bits{};
+        storage.for_each([&bits](const T& value)
         {
-            std::cout << "  {";
-            bool first = true;
+            std::size_t bit = signature_bit(element_hash(value));
+            bits[bit / 64] |= uint64_t{1} << (bit % 64);
+        });
+        for (std::size_t i = 0; i < signature_words; i++) signature_bits[i].store(bits[i], std::memory_order_relaxed);
+        signature_valid.store(true, std::memory_order_release);
+    }
 
-            for (int i = 0; i < n; i++)
-            {
-                if (mask & (1 << i))
-                {
-                    if (!first) std::cout << ", ";
-                    std::cout << elements[i];
-                    first = false;
-                }
-            }
-            std::cout << "}";
-            if (mask < total - 1) std::cout << ",";
-            std::cout << "\n";
-        }
-        std::cout << "}" << std::endl;
+    bool summaries_known(const BasicSet& other) const
+    {
+        return summary_valid.load(std::memory_order_acquire) && other.summary_valid.load(std::memory_order_acquire);
+    }
+
+    // мощности или хеши известны и различаются - множества не равны
+    bool summaries_differ(const BasicSet& other) const
+    {
+        return summaries_known(other) &&
+               (cached_size.load(std::memory_order_relaxed) != other.cached_size.load(std::memory_order_relaxed) ||
+                content_hash.load(std::memory_order_relaxed) != other.content_hash.load(std::memory_order_relaxed));
+    }
+
+private:
+    void print_elements(std::ostream& out) const
+    {
+        bool first = true;
+        storage.for_each([&first, &out](const T& value)
+        {
+            if (!first) out << ", ";
+            out << value;
+            first = false;
+        });
     }
 
 public:
-    Set* union_merge(const Set& other) const
+    static void see(std::ostream& out = std::cout)
     {
-        if (head == nullptr || other.head == nullptr)
+        if (registry.size() == 0)
         {
-            throw std::logic_error("множетсва должны быть инициализированы");
+            out << "Не создано ни одного множества\n";
+            return;
         }
 
-        char new_name = 'A';
-        for (int i = 0; i < 26; i++)
+        auto guard = read_guard();
+        out << "Список всех множеств:\n";
+        registry.for_each([&out](BasicSet *set)
+        {
+            out << "  " << set->name << ": { ";
+            set->print_elements(out);
+            out << " }\n";
+        });
+    }
+
+public:
+    void see(std::string_view set_name, std::ostream& out = std::cout) const
+    {
+        if (find_set(set_name) == nullptr)
         {
-            new_name = 'A' + i;
-            if (Set::find_set(new_name) == nullptr) break;
+            throw std::invalid_argument("множество не существует");
         }
 
-        Set* result = new Set(new_name);
+        out << "Элементы множества " << name << ": { ";
+        print_elements(out);
+        out << " }\n";
+    }
 
-        Node* currentA = this->head->next;
-        Node* currentB = other.head->next;
 
-        while (currentA && currentB)
+private:
+    std::vector<T> elements() const
+    {
+        std::vector<T> result;
+        result.reserve(storage.size());
+        storage.for_each([&result](const T& value) { result.push_back(value); });
+        return result;
+    }
+
+    SubsetFormatter subset_formatter(const std::vector<T>& elements) const
+    {
+        std::vector<std::string> names;
+        names.reserve(elements.size());
+        for (const T& value : elements)
         {
-            if (currentA->data < currentB->data)
-            {
-                result->add(currentA->data);
-                currentA = currentA->next;
-            }
-            else if (currentA->data > currentB->data)
-            {
-                result->add(currentB->data);
-                currentB = currentB->next;
-            }
-            else
-            {
-                result->add(currentA->data);
-                currentA = currentA->next;
-                currentB = currentB->next;
-            }
+            std::ostringstream text;
+            text << value;
+            names.push_back(text.str());
         }
+        return SubsetFormatter(std::move(names));
+    }
 
-        while (currentA) {
-            result->add(currentA->data);
-            currentA = currentA->next;
-        }
-        while (currentB) {
-            result->add(currentB->data);
-            currentB = currentB->next;
+public:
+    // Булеан без материализации: маски подмножеств, бит i - i-й элемент в порядке обхода.
+    PowerSetRange power_set(bool gray = false) const
+    {
+        return PowerSetRange(static_cast<unsigned>(storage.size()), gray);
+    }
+
+    // Передаёт каждое подмножество в sink(mask, elements), где elements[i] соответствует биту i.
+    template <typename Sink>
+        requires std::invocable<Sink&, uint64_t, const std::vector<T>&>
+    void pow(Sink&& sink, bool gray = false) const
+    {
+        std::vector<T> items = elements();
+        for (uint64_t mask : PowerSetRange(static_cast<unsigned>(items.size()), gray))
+        {
+            sink(mask, static_cast<const std::vector<T>&>(items));
         }
+    }
 
-        return result;
+    void pow(std::ostream& out = std::cout, bool gray = false) const
+    {
+        std::vector<T> items = elements();
+        PowerSetRange range(static_cast<unsigned>(items.size()), gray);
+
+        out << "булеан: " << name << ": {\n";
+        write_power_set(out, subset_formatter(items), range, range.size());
+        out << "}\n";
     }
 
-public:
-    Set* intersection_merge(const Set& other) const
+    // тот же вывод, что у pow(out), но куски булеана форматируются параллельно
+    void pow_parallel(std::ostream& out, const ParallelOptions& options = {}, bool gray = false) const
+    {
+        std::vector<T> items = elements();
+
+        out << "булеан: " << name << ": {\n";
+        parallel_write_power_set(out, subset_formatter(items), static_cast<unsigned>(items.size()), gray, options);
+        out << "}\n";
+    }
+
+    // неупорядоченный параллельный вывод в файлы "<prefix>.<номер потока>"
+    std::vector<std::string> pow_to_files(const std::string& prefix, const ParallelOptions& options = {},
+                                          bool gray = false) const
+    {
+        std::vector<T> items = elements();
+        return parallel_write_power_set_files(prefix, subset_formatter(items), static_cast<unsigned>(items.size()),
+                                              gray, options);
+    }
+
+    // число подмножеств, для масок которых pred(mask) истинно, без вывода
+    template <typename Pred>
+    uint64_t count_subsets(Pred pred, const ParallelOptions& options = {}) const
     {
-        if (head == nullptr || other.head == nullptr)
+        return parallel_count_subsets(static_cast<unsigned>(storage.size()), pred, options);
+    }
+
+private:
+    void require_initialized(const BasicSet& other) const
+    {
+        if (!initialized || !other.initialized)
         {
             throw std::logic_error("множетсва должны быть инициализированы");
         }
+    }
 
-        char new_name = 'A';
-        for (int i = 0; i < 26; i++)
-        {
-            new_name = 'A' + i;
-            if (Set::find_set(new_name) == nullptr) break;
-        }
+public:
+    BasicSet* union_merge(const BasicSet& other) const
+    {
+        require_initialized(other);
 
+        std::unique_ptr<BasicSet> result(new BasicSet());
+        Storage::unite(storage, other.storage, result->storage);
+        return publish(std::move(result));
+    }
 
+public:
+    BasicSet* intersection_merge(const BasicSet& other) const
+    {
+        require_initialized(other);
 
-        Set* result = new Set(new_name);
+        std::unique_ptr<BasicSet> result(new BasicSet());
+        Storage::intersect(storage, other.storage, result->storage);
+        return publish(std::move(result));
+    }
+
+public:
+    BasicSet* difference_merge(const BasicSet& other) const
+    {
+        require_initialized(other);
 
-        Node* currentA = this->head->next;
-        Node* currentB = other.head->next;
+        std::unique_ptr<BasicSet> result(new BasicSet());
+        Storage::subtract(storage, other.storage, result->storage);
+        return publish(std::move(result));
+    }
+
+public:
+    // (A \ B) ∪ (B \ A) одним проходом слияния, без двух промежуточных разностей
+    BasicSet* symmetric_difference_merge(const BasicSet& other) const
+    {
+        require_initialized(other);
+
+        std::unique_ptr<BasicSet> result(new BasicSet());
+        Storage::sym_difference(storage, other.storage, result->storage);
+        return publish(std::move(result));
+    }
+
+public:
+    // Дополнение до универсума: universe \ A. Элементы A вне универсума не учитываются.
+    BasicSet* complement_in(const BasicSet& universe) const
+    {
+        require_initialized(universe);
 
-        while (currentA != nullptr && currentB != nullptr)
+        std::unique_ptr<BasicSet> result(new BasicSet());
+        Storage::subtract(universe.storage, storage, result->storage);
+        return publish(std::move(result));
+    }
+
+    // Дополнение до диапазона [first, last] без построения множества-универсума.
+    // Битовая карта считает его пословно, остальные хранилища заполняют промежутки
+    // между элементами A, попавшими в диапазон.
+    BasicSet* complement(T first, T last) const
+        requires std::is_integral_v<T>
+    {
+        if (!initialized)
+        {
+            throw std::logic_error("множество не инициализировано");
+        }
+        if (last < first)
         {
-            if (currentA->data < currentB->data)
+            throw std::invalid_argument("начало диапазона больше конца");
+        }
+
+        std::unique_ptr<BasicSet> result(new BasicSet());
+        if constexpr (requires(Storage& out) { Storage::complement(storage, first, last, out); })
+        {
+            Storage::complement(storage, first, last, result->storage);
+        }
+        else
+        {
+            std::vector<T> inside;
+            storage.for_each([&](const T& value)
+            {
+                if (first <= value && value <= last) inside.push_back(value);
+            });
+            if constexpr (!requires { storage.items(); })
             {
-                currentA = currentA->next;
+                std::sort(inside.begin(), inside.end());
             }
-            else if (currentA->data > currentB->data)
+
+            // next - наименьший ещё не рассмотренный элемент диапазона; цикл не шагает
+            // за last, чтобы не переполнить T при last, равном максимуму типа
+            std::vector<T> gaps;
+            T next = first;
+            bool done = false;
+            for (T value : inside)
             {
-                currentB = currentB->next;
+                for (; next < value; ++next) gaps.push_back(next);
+                if (value == last)
+                {
+                    done = true;
+                    break;
+                }
+                next = static_cast<T>(value + 1);
             }
-            else
+            while (!done)
             {
-                result->add(currentA->data);
-                currentA = currentA->next;
-                currentB = currentB->next;
+                gaps.push_back(next);
+                done = next == last;
+                if (!done) ++next;
             }
+            result->assign_sorted(gaps.begin(), gaps.end());
         }
-        return result;
+        return publish(std::move(result));
     }
 
 public:
-    Set* difference_merge(const Set& other) const
+    // Декартово произведение A × B потоком: sink(a, b) вызывается для каждой пары,
+    // пары не материализуются.
+    template <typename Sink>
+    void for_each_pair(const BasicSet& other, Sink sink) const
     {
-        if (head == nullptr || other.head == nullptr)
+        require_initialized(other);
+        storage.for_each([&](const T& a)
         {
-            throw std::logic_error("множетсва должны быть инициализированы");
-        }
+            other.storage.for_each([&](const T& b) { sink(a, b); });
+        });
+    }
+
+    // Записывает A × B в структуру отношения: пары добавляются в relation.pairs.
+    // Если у структуры есть носитель relation.set (как у Datastruct из 2task.h),
+    // в него дописываются недостающие элементы A ∪ B.
+    template <typename Relation>
+    void product_into(const BasicSet& other, Relation& relation) const
+    {
+        require_initialized(other);
+        relation.pairs.reserve(relation.pairs.size() + size() * other.size());
+        for_each_pair(other, [&relation](const T& a, const T& b) { relation.pairs.emplace_back(a, b); });
 
-        char new_name = 'A';
-        for (int i = 0; i < 26; i++)
+        if constexpr (requires { relation.set.push_back(std::declval<T>()); })
         {
-            new_name = 'A' + i;
-            if (Set::find_set(new_name) == nullptr) break;
+            auto add_to_carrier = [&relation](const T& value)
+            {
+                if (std::find(relation.set.begin(), relation.set.end(), value) == relation.set.end())
+                {
+                    relation.set.push_back(value);
+                }
+            };
+            storage.for_each(add_to_carrier);
+            other.storage.for_each(add_to_carrier);
         }
+    }
 
-        Set* result = new Set(new_name);
+public:
+    // Мощности результатов операций без построения и регистрации множества.
+    // Все они выводятся из |A ∩ B|, который хранилище считает без записи результата:
+    // битовая карта - popcount по словам, отсортированный массив - подсчётом при слиянии.
+    std::size_t intersection_size(const BasicSet& other) const
+    {
+        require_initialized(other);
+        return Storage::intersect_count(storage, other.storage);
+    }
 
-        Node* currentA = this->head->next;
-        Node* currentB = other.head->next;
+    std::size_t union_size(const BasicSet& other) const
+    {
+        return size() + other.size() - intersection_size(other);
+    }
 
-        while (currentA != nullptr && currentB != nullptr)
-        {
-            if (currentA->data < currentB->data)
-            {
+    std::size_t difference_size(const BasicSet& other) const
+    {
+        return size() - intersection_size(other);
+    }
 
-                result->add(currentA->data);
-                currentA = currentA->next;
-            }
-            else if (currentA->data > currentB->data)
-            {
+    std::size_t symmetric_difference_size(const BasicSet& other) const
+    {
+        return size() + other.size() - 2 * intersection_size(other);
+    }
 
-                currentB = currentB->next;
-            }
-            else
+    // коэффициент Жаккара |A ∩ B| / |A ∪ B|; для двух пустых множеств - 1
+    double jaccard(const BasicSet& other) const
+    {
+        std::size_t common = intersection_size(other);
+        std::size_t all = size() + other.size() - common;
+        return all == 0 ? 1.0 : static_cast<double>(common) / static_cast<double>(all);
+    }
+
+    // коэффициент перекрытия |A ∩ B| / min(|A|, |B|): 1, если одно множество содержится
+    // в другом; если пусто хотя бы одно, 1 только для двух пустых
+    double overlap(const BasicSet& other) const
+    {
+        std::size_t common = intersection_size(other);
+        std::size_t smaller = std::min(size(), other.size());
+        if (smaller == 0) return size() == other.size() ? 1.0 : 0.0;
+        return static_cast<double>(common) / static_cast<double>(smaller);
+    }
+
+public:
+    // Сводка строится при первом запросе оценки и дальше поддерживается add/rem.
+    void enable_sketch()
+    {
+        if (sketch) return;
+        sketch = std::make_unique<SetSketch>();
+        sketch_valid.store(false, std::memory_order_relaxed);
+    }
+
+    void disable_sketch()
+    {
+        sketch.reset();
+        sketch_valid.store(false, std::memory_order_relaxed);
+    }
+
+    bool has_sketch() const
+    {
+        return sketch != nullptr;
+    }
+
+    // Приближённые мощности и сходство по сводкам за время, не зависящее от размера
+    // множеств. Если сводки нет хотя бы у одного множества, ответ точный.
+    double estimated_size() const
+    {
+        const SetSketch *own = ensure_sketch();
+        return own != nullptr ? own->estimate_size() : static_cast<double>(size());
+    }
+
+    double estimated_union_size(const BasicSet& other) const
+    {
+        require_initialized(other);
+        const SetSketch *a = ensure_sketch(), *b = other.ensure_sketch();
+        if (a == nullptr || b == nullptr) return static_cast<double>(union_size(other));
+        return SetSketch::estimate_union_size(*a, *b);
+    }
+
+    double estimated_jaccard(const BasicSet& other) const
+    {
+        require_initialized(other);
+        const SetSketch *a = ensure_sketch(), *b = other.ensure_sketch();
+        if (a == nullptr || b == nullptr) return jaccard(other);
+        return SetSketch::estimate_jaccard(*a, *b);
+    }
+
+    // |A ∩ B| = J(A, B) · |A ∪ B|
+    double estimated_intersection_size(const BasicSet& other) const
+    {
+        require_initialized(other);
+        const SetSketch *a = ensure_sketch(), *b = other.ensure_sketch();
+        if (a == nullptr || b == nullptr) return static_cast<double>(intersection_size(other));
+        return SetSketch::estimate_jaccard(*a, *b) * SetSketch::estimate_union_size(*a, *b);
+    }
+
+    // Оценка |A ∪ B ∪ ...| слиянием сводок. Без сводки у какого-либо множества
+    // объединение считается точно во временном хранилище, не попадая в реестр.
+    static double estimated_union_all(const std::vector<const BasicSet*>& sets)
+    {
+        if (sets.empty())
+        {
+            throw std::invalid_argument("не указано ни одного множества");
+        }
+
+        SetSketch merged;
+        bool sketched = true;
+        for (const BasicSet* set : sets)
+        {
+            set->require_initialized(*set);
+            const SetSketch *own = sketched ? set->ensure_sketch() : nullptr;
+            if (own == nullptr)
             {
-                currentA = currentA->next;
-                currentB = currentB->next;
+                sketched = false;
+                continue;
             }
+            merged.merge(*own);
         }
-        while (currentA != nullptr)
+        if (sketched) return merged.estimate_size();
+
+        std::vector<const Storage*> storages;
+        storages.reserve(sets.size());
+        for (const BasicSet* set : sets) storages.push_back(&set->storage);
+        Storage result;
+        Storage::unite_all(storages, result);
+        return static_cast<double>(result.size());
+    }
+
+private:
+    const SetSketch* ensure_sketch() const
+    {
+        if (!sketch) return nullptr;
+        if (sketch_valid.load(std::memory_order_acquire)) return sketch.get();
+
+        std::lock_guard<std::mutex> lock(sketch_mutex);
+        if (!sketch_valid.load(std::memory_order_relaxed))
         {
-            result->add(currentA->data);
-            currentA = currentA->next;
+            sketch->clear();
+            storage.for_each([this](const T& value) { sketch->add(element_hash(value)); });
+            sketch_valid.store(true, std::memory_order_release);
         }
-
-        return result;
+        return sketch.get();
     }
 
 public:
-    bool is_subset_of(const Set& other) const
+    // Объединение и пересечение любого числа множеств одной операцией хранилища:
+    // цепочка A + B + C создала бы промежуточное множество на каждом шаге и
+    // перечитывала бы растущий результат (O(k·N) для k операндов).
+    static BasicSet* union_all(const std::vector<const BasicSet*>& sets)
+    {
+        return combine_all(sets, Storage::unite_all);
+    }
+
+    static BasicSet* intersect_all(const std::vector<const BasicSet*>& sets)
+    {
+        return combine_all(sets, Storage::intersect_all);
+    }
+
+private:
+    static BasicSet* combine_all(const std::vector<const BasicSet*>& sets,
+                                 void (*op)(std::span<const Storage* const>, Storage&))
     {
-        if (head == nullptr || other.head == nullptr)
+        if (sets.empty())
         {
-            throw std::logic_error("множетсва должны быть инициализированы");
+            throw std::invalid_argument("не указано ни одного множества");
         }
 
-        Node* currentA = this->head->next;
-        Node* currentB = other.head->next;
+        std::vector<const Storage*> storages;
+        storages.reserve(sets.size());
+        for (const BasicSet* set : sets)
+        {
+            set->require_initialized(*set);
+            storages.push_back(&set->storage);
+        }
 
-        while (currentA != nullptr && currentB != nullptr)
+        std::unique_ptr<BasicSet> result(new BasicSet());
+        op(storages, result->storage);
+        return publish(std::move(result));
+    }
+
+public:
+    // Вычисляет составное выражение одним проходом и регистрирует только итоговое множество.
+    // Для битовых карт выражение считается пословно, для остальных хранилищ -
+    // поэлементно по кандидатам из операндов (результат всегда лежит в их объединении).
+    static BasicSet* evaluate(const SetExpression& expr)
+    {
+        auto guard = read_guard();
+        std::vector<const BasicSet*> leaves;
+        leaves.reserve(expr.operand_names().size());
+        for (const std::string& operand : expr.operand_names())
         {
-            if (currentA->data < currentB->data)
+            const BasicSet* set = find_set(operand);
+            if (set == nullptr)
             {
-                return false;
+                throw std::invalid_argument("множество " + operand + " не существует");
             }
-            else if (currentA->data > currentB->data)
+            leaves.push_back(set);
+        }
+
+        std::unique_ptr<BasicSet> result(new BasicSet());
+        if constexpr (requires(const Storage& s) { s.word_count(); s.word(std::size_t{0}); })
+        {
+            std::size_t count = 0;
+            for (const BasicSet* leaf : leaves) count = std::max(count, leaf->storage.word_count());
+            result->storage.assign_words(count, [&](std::size_t i)
+            {
+                return expr.eval<uint64_t>([&](std::size_t leaf) { return leaves[leaf]->storage.word(i); });
+            });
+        }
+        else
+        {
+            std::vector<T> hits;
+            for (std::size_t k = 0; k < leaves.size(); k++)
             {
-                currentB = currentB->next;
+                leaves[k]->storage.for_each([&](const T& value)
+                {
+                    // элемент уже рассмотрен, если он есть в одном из предыдущих операндов
+                    for (std::size_t j = 0; j < k; j++)
+                    {
+                        if (leaves[j]->storage.contains(value)) return;
+                    }
+                    if (expr.eval<bool>([&](std::size_t leaf) { return leaves[leaf]->storage.contains(value); }))
+                    {
+                        hits.push_back(value);
+                    }
+                });
+            }
+
+            if constexpr (requires(const T& a, const T& b) { a < b; })
+            {
+                std::sort(hits.begin(), hits.end());
+                result->assign_sorted(hits.begin(), hits.end());
             }
             else
             {
-                currentA = currentA->next;
-                currentB = currentB->next;
+                for (const T& value : hits) result->storage.insert(value);
             }
         }
+        return publish(std::move(result));
+    }
 
-        return (currentA == nullptr);
+public:
+    // Сохраняет все множества реестра в снимок (формат описан в snapshot.h).
+    static void save_snapshot(const std::string& path)
+    {
+        auto guard = read_guard();
+        std::vector<std::pair<std::string, const Storage*>> sets;
+        sets.reserve(registry.size());
+        registry.for_each([&sets](BasicSet *set) { sets.emplace_back(set->name, &set->storage); });
+        write_snapshot<Storage, T>(path, sets);
     }
 
-private:
-    bool is_equal_to(const Set& other) const
+    // Открывает снимок отображением в память и регистрирует его множества без копирования
+    // данных: они читают файл на месте, а при первом изменении копируют свои данные
+    // (копирование при записи). Возвращает число множеств; загруженные множества
+    // дописываются в loaded, если он передан.
+    static std::size_t load_snapshot(const std::string& path, std::vector<BasicSet*>* loaded = nullptr)
     {
-        if (head == nullptr || other.head == nullptr)
+        std::shared_ptr<MappedFile> file = MappedFile::open(path);
+        std::vector<SnapshotRecord> records = read_snapshot_index<Storage, T>(*file);
+
+        // все имена проверяются до регистрации первого множества: плохой снимок не загружается вовсе
+        std::vector<std::string_view> names;
+        names.reserve(records.size());
+        for (const SnapshotRecord& record : records)
         {
-            throw std::logic_error("множетсва должны быть инициализированы");
+            std::string set_name(record.name);
+            if (!is_valid_name(set_name) || find_set(set_name) != nullptr)
+            {
+                throw std::logic_error("множество " + set_name + " уже существует или имеет недопустимое имя");
+            }
+            names.push_back(record.name);
+        }
+        std::sort(names.begin(), names.end());
+        auto repeated = std::adjacent_find(names.begin(), names.end());
+        if (repeated != names.end())
+        {
+            throw std::logic_error("имя " + std::string(*repeated) + " встречается в снимке дважды");
         }
 
-        Node* currentA = this->head->next;
-        Node* currentB = other.head->next;
-
-        while (currentA != nullptr && currentB != nullptr)
+        // имя могли занять другим потоком после проверки - тогда загруженное откатывается
+        std::vector<BasicSet*> published;
+        published.reserve(records.size());
+        try
         {
-            if (currentA->data != currentB->data)
+            for (const SnapshotRecord& record : records)
             {
-                return false;
+                std::unique_ptr<BasicSet> set(new BasicSet());
+                set->storage = SnapshotCodec<Storage>::view(record.payload, record.count, file);
+                published.push_back(publish(std::move(set), std::string(record.name)));
             }
-            currentA = currentA->next;
-            currentB = currentB->next;
         }
-        return (currentA == nullptr && currentB == nullptr);
+        catch (...)
+        {
+            for (BasicSet *set : published) retire(set);
+            throw;
+        }
+        if (loaded != nullptr) loaded->insert(loaded->end(), published.begin(), published.end());
+        return records.size();
     }
 
 public:
-    bool operator<(const Set& other) const
+    bool is_subset_of(const BasicSet& other) const
     {
-        return is_subset_of(other) && !is_equal_to(other);
+        require_initialized(other);
+        if (this == &other) return true;
+        if (summaries_known(other) &&
+            cached_size.load(std::memory_order_relaxed) > other.cached_size.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        return Storage::is_subset(storage, other.storage);
+    }
+
+private:
+    bool is_equal_to(const BasicSet& other) const
+    {
+        require_initialized(other);
+        if (this == &other) return true;
+        if (summaries_differ(other)) return false;
+        return Storage::equal(storage, other.storage);
     }
 
-    bool operator<=(const Set& other) const
+public:
+    // собственное подмножество: подмножество меньшей мощности
+    bool operator<(const BasicSet& other) const
+    {
+        require_initialized(other);
+        if (this == &other) return false;
+        if (summaries_known(other) &&
+            cached_size.load(std::memory_order_relaxed) >= other.cached_size.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        return is_subset_of(other) && size() < other.size();
+    }
+
+    bool operator<=(const BasicSet& other) const
     {
         return is_subset_of(other);
     }
 
 
-    bool operator==(const Set& other) const
+    bool operator==(const BasicSet& other) const
     {
         return is_equal_to(other);
     }
 
-    bool operator!=(const Set& other) const
+    bool operator!=(const BasicSet& other) const
     {
         return !is_equal_to(other);
     }
+
+public:
+    // Группы одинаковых множеств реестра (в каждой не меньше двух) в порядке создания.
+    // Кандидаты отбираются по хешу содержимого, совпадение подтверждается сравнением.
+    // Если множества могут удаляться из других потоков, вызывающий держит read_guard.
+    static std::vector<std::vector<BasicSet*>> duplicates()
+    {
+        auto guard = read_guard();
+        std::vector<std::vector<BasicSet*>> groups;
+        std::unordered_map<uint64_t, std::vector<std::size_t>> by_hash;
+        registry.for_each([&](BasicSet *set)
+        {
+            std::vector<std::size_t>& candidates = by_hash[set->hash()];
+            for (std::size_t group : candidates)
+            {
+                if (*groups[group].front() == *set)
+                {
+                    groups[group].push_back(set);
+                    return;
+                }
+            }
+            candidates.push_back(groups.size());
+            groups.push_back({set});
+        });
+
+        std::erase_if(groups, [](const std::vector<BasicSet*>& group) { return group.size() < 2; });
+        return groups;
+    }
+
+public:
+    // Индекс включений по всем множествам реестра (см. subset_index.h): копия
+    // сохранённого индекса, при изменениях после последнего запроса - построенного заново.
+    // Как и для duplicates(), при удалении из других потоков вызывающий держит read_guard.
+    static SubsetIndex<BasicSet> subset_index()
+    {
+        return with_subset_index([](const SubsetIndex<BasicSet>& index) { return index; });
+    }
+
+    // все множества реестра, кроме x, которые содержатся в x / содержат x;
+    // серия запросов без изменений между ними строит индекс один раз
+    static std::vector<BasicSet*> subsets_of(const BasicSet& x)
+    {
+        return with_subset_index([&x](const SubsetIndex<BasicSet>& index) { return index.subsets_of(x); });
+    }
+
+    static std::vector<BasicSet*> supersets_of(const BasicSet& x)
+    {
+        return with_subset_index([&x](const SubsetIndex<BasicSet>& index) { return index.supersets_of(x); });
+    }
+
+private:
+    // флаг ставится до обхода реестра: изменение во время построения сбросит его снова
+    template <typename Query>
+    static auto with_subset_index(Query query)
+    {
+        auto guard = read_guard();
+        SubsetIndexCache& cache = subset_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        if (!cache.index || !subset_index_fresh().load(std::memory_order_relaxed))
+        {
+            subset_index_fresh().store(true, std::memory_order_relaxed);
+            std::vector<BasicSet*> sets;
+            sets.reserve(registry.size());
+            registry.for_each([&sets](BasicSet *set) { sets.push_back(set); });
+            cache.index.emplace(sets);
+        }
+        return query(*cache.index);
+    }
 };
 
-inline std::vector<Set*> Set::all_sets = {};
+template <typename T, typename Storage>
+inline SetRegistry<BasicSet<T, Storage>> BasicSet<T, Storage>::registry = {};
+
+// множество символов, с которым работает консольное меню
+using Set = BasicSet<char, BitmapStorage<char>>;
+
+template <typename T>
+using BitmapSet = BasicSet<T, BitmapStorage<T>>;
+
+template <typename T>
+using SortedSet = BasicSet<T, SortedVectorStorage<T>>;
+
+template <typename T>
+using HashSet = BasicSet<T, HashStorage<T>>;
+
+// большие разреженные множества целых (до 32 бит)
+template <typename T>
+using RoaringSet = BasicSet<T, RoaringStorage<T>>;
 
-#endif //DISCRETE_MATHEMATICS_1TASK_H
\ No newline at end of file
+#endif //DISCRETE_MATHEMATICS_1TASK_H
@@ -0,0 +1,59 @@
+#ifndef DISCRETE_MATHEMATICS_BUFFERED_WRITER_H
+#define DISCRETE_MATHEMATICS_BUFFERED_WRITER_H
+
+#include <cstddef>
+#include <cstdio>
+#include <streambuf>
+#include <vector>
+
+// Буфер потока вывода поверх FILE*: текст копится в большом буфере и уходит
+// в файл одним fwrite, когда буфер заполнен или при явном flush.
+// Все сообщения консольного меню идут через один такой буфер.
+class BufferedWriter : public std::streambuf
+{
+private:
+    std::FILE *file;
+    std::vector<char> buffer;
+
+    bool write_out()
+    {
+        std::size_t size = static_cast<std::size_t>(pptr() - pbase());
+        bool ok = size == 0 || std::fwrite(pbase(), 1, size, file) == size;
+        setp(buffer.data(), buffer.data() + buffer.size());
+        return ok;
+    }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (!write_out())
+        {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override
+    {
+        bool ok = write_out();
+        return ok && std::fflush(file) == 0 ? 0 : -1;
+    }
+
+public:
+    explicit BufferedWriter(std::FILE *file, std::size_t capacity = 1 << 20) : file(file), buffer(capacity)
+    {
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    ~BufferedWriter() override
+    {
+        sync();
+    }
+};
+
+#endif //DISCRETE_MATHEMATICS_BUFFERED_WRITER_H
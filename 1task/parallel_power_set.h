@@ -0,0 +1,264 @@
+#ifndef DISCRETE_MATHEMATICS_PARALLEL_POWER_SET_H
+#define DISCRETE_MATHEMATICS_PARALLEL_POWER_SET_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "power_set.h"
+
+// Параллельный обход булеана: пространство номеров подмножеств [0, 2^n) режется
+// на куски по chunk_size, куски разбирают рабочие потоки.
+struct ParallelOptions
+{
+    unsigned threads = 0;          // 0 - по числу ядер
+    uint64_t chunk_size = 1 << 14; // подмножеств в одном куске
+    std::size_t window = 0;        // сколько готовых кусков может ждать вывода, 0 - 4 на поток
+
+    unsigned thread_count() const
+    {
+        unsigned hw = std::thread::hardware_concurrency();
+        return threads != 0 ? threads : std::max(1u, hw);
+    }
+};
+
+namespace detail
+{
+    // Запускает body(worker) в count потоках и пробрасывает первое исключение.
+    template <typename Body>
+    void run_workers(unsigned count, Body body)
+    {
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(count);
+            for (unsigned w = 0; w < count; w++)
+            {
+                workers.emplace_back([&, w]
+                {
+                    try
+                    {
+                        body(w);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error) error = std::current_exception();
+                    }
+                });
+            }
+        }
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+// Упорядоченный вывод: каждый поток форматирует свой кусок в собственный буфер,
+// главный поток пишет буферы в out строго по возрастанию номера куска.
+// Число кусков, ожидающих вывода, ограничено окном, поэтому память не растёт с 2^n.
+inline void parallel_write_power_set(std::ostream& out, const SubsetFormatter& formatter, unsigned n, bool gray,
+                                     const ParallelOptions& options = {})
+{
+    const uint64_t total = PowerSetRange(n).size();
+    const uint64_t chunk = std::max<uint64_t>(1, options.chunk_size);
+    const uint64_t chunks = (total + chunk - 1) / chunk;
+    const unsigned workers = options.thread_count();
+    const std::size_t window = options.window != 0 ? options.window : std::size_t{4} * workers;
+
+    std::mutex mutex;
+    std::condition_variable ready_cv;
+    std::condition_variable space_cv;
+    std::map<uint64_t, std::string> ready;
+    uint64_t next_chunk = 0;
+    uint64_t emitted = 0;
+    bool failed = false;
+    std::exception_ptr error;
+
+    auto fail = [&](std::exception_ptr e)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = e;
+            failed = true;
+        }
+        ready_cv.notify_all();
+        space_cv.notify_all();
+    };
+
+    std::vector<std::jthread> pool;
+    pool.reserve(workers);
+    for (unsigned w = 0; w < workers; w++)
+    {
+        pool.emplace_back([&]
+        {
+            try
+            {
+                while (true)
+                {
+                    uint64_t k;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        space_cv.wait(lock, [&] { return failed || next_chunk - emitted < window; });
+                        if (failed || next_chunk >= chunks) return;
+                        k = next_chunk++;
+                    }
+
+                    std::string buffer;
+                    PowerSetRange range(k * chunk, std::min(total, (k + 1) * chunk), gray);
+                    for (auto it = range.begin(); it != range.end(); ++it)
+                    {
+                        buffer += "  ";
+                        formatter.append(buffer, *it);
+                        if (it.position() + 1 < total) buffer += ',';
+                        buffer += '\n';
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ready.emplace(k, std::move(buffer));
+                    }
+                    ready_cv.notify_all();
+                }
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+            }
+        });
+    }
+
+    try
+    {
+        for (uint64_t k = 0; k < chunks; k++)
+        {
+            std::string buffer;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready_cv.wait(lock, [&] { return failed || ready.count(k) != 0; });
+                if (failed) break;
+                auto it = ready.find(k);
+                buffer = std::move(it->second);
+                ready.erase(it);
+                emitted++;
+            }
+            space_cv.notify_all();
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+    }
+    catch (...)
+    {
+        fail(std::current_exception());
+    }
+
+    pool.clear();
+    if (error) std::rethrow_exception(error);
+}
+
+// Неупорядоченный вывод: поток w пишет свои куски в файл "<prefix>.<w>".
+// Возвращает имена созданных файлов.
+inline std::vector<std::string> parallel_write_power_set_files(const std::string& prefix,
+                                                               const SubsetFormatter& formatter, unsigned n,
+                                                               bool gray, const ParallelOptions& options = {})
+{
+    const uint64_t total = PowerSetRange(n).size();
+    const uint64_t chunk = std::max<uint64_t>(1, options.chunk_size);
+    const unsigned workers = options.thread_count();
+
+    std::vector<std::string> files;
+    for (unsigned w = 0; w < workers; w++)
+    {
+        files.push_back(prefix + "." + std::to_string(w));
+    }
+
+    std::atomic<uint64_t> next{0};
+    detail::run_workers(workers, [&](unsigned w)
+    {
+        std::ofstream file(files[w], std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("не удалось открыть файл " + files[w]);
+        }
+
+        std::string buffer;
+        for (uint64_t first; (first = next.fetch_add(chunk)) < total;)
+        {
+            buffer.clear();
+            PowerSetRange range(first, std::min(total, first + chunk), gray);
+            for (uint64_t mask : range)
+            {
+                formatter.append(buffer, mask);
+                buffer += '\n';
+            }
+            file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+    });
+    return files;
+}
+
+// Параллельная свёртка по всем подмножествам без вывода:
+// каждый поток копит local = map(local, mask) по своим кускам, затем частичные
+// результаты объединяются через combine в порядке номеров потоков.
+template <typename Acc, typename Map, typename Combine>
+Acc parallel_reduce_power_set(unsigned n, Acc init, Map map, Combine combine, const ParallelOptions& options = {})
+{
+    const uint64_t total = PowerSetRange(n).size();
+    const uint64_t chunk = std::max<uint64_t>(1, options.chunk_size);
+    const unsigned workers = options.thread_count();
+
+    std::vector<Acc> partial(workers, init);
+    std::atomic<uint64_t> next{0};
+    detail::run_workers(workers, [&](unsigned w)
+    {
+        Acc local = init;
+        for (uint64_t first; (first = next.fetch_add(chunk)) < total;)
+        {
+            for (uint64_t mask : PowerSetRange(first, std::min(total, first + chunk), false))
+            {
+                local = map(std::move(local), mask);
+            }
+        }
+        partial[w] = std::move(local);
+    });
+
+    Acc result = init;
+    for (Acc& value : partial)
+    {
+        result = combine(std::move(result), std::move(value));
+    }
+    return result;
+}
+
+// число подмножеств, удовлетворяющих pred(mask)
+template <typename Pred>
+uint64_t parallel_count_subsets(unsigned n, Pred pred, const ParallelOptions& options = {})
+{
+    return parallel_reduce_power_set(n, uint64_t{0},
+                                     [&pred](uint64_t acc, uint64_t mask) { return acc + (pred(mask) ? 1 : 0); },
+                                     [](uint64_t a, uint64_t b) { return a + b; }, options);
+}
+
+// суммарная мощность всех подмножеств, удовлетворяющих pred(mask)
+template <typename Pred>
+uint64_t parallel_sum_subset_sizes(unsigned n, Pred pred, const ParallelOptions& options = {})
+{
+    return parallel_reduce_power_set(n, uint64_t{0},
+                                     [&pred](uint64_t acc, uint64_t mask)
+                                     {
+                                         return pred(mask) ? acc + std::popcount(mask) : acc;
+                                     },
+                                     [](uint64_t a, uint64_t b) { return a + b; }, options);
+}
+
+#endif //DISCRETE_MATHEMATICS_PARALLEL_POWER_SET_H
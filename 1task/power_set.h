@@ -0,0 +1,151 @@
+#ifndef DISCRETE_MATHEMATICS_POWER_SET_H
+#define DISCRETE_MATHEMATICS_POWER_SET_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Ленивый булеан множества из n элементов: подмножества выдаются как n-битные маски,
+// бит i означает i-й элемент в порядке обхода множества. Ничего не выделяется,
+// итератор - это счётчик. В порядке кода Грея соседние маски отличаются одним битом.
+class PowerSetRange
+{
+public:
+    static constexpr unsigned max_elements = 63;
+
+    class iterator
+    {
+    private:
+        uint64_t index;
+        bool gray;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = uint64_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = uint64_t;
+
+        iterator() : index(0), gray(false) {}
+        iterator(uint64_t index, bool gray) : index(index), gray(gray) {}
+
+        uint64_t operator*() const
+        {
+            return gray ? index ^ (index >> 1) : index;
+        }
+
+        // порядковый номер подмножества в обходе
+        uint64_t position() const
+        {
+            return index;
+        }
+
+        iterator& operator++()
+        {
+            index++;
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator old = *this;
+            index++;
+            return old;
+        }
+
+        bool operator==(const iterator& other) const
+        {
+            return index == other.index;
+        }
+    };
+
+private:
+    uint64_t first;
+    uint64_t last;
+    bool gray;
+
+public:
+    explicit PowerSetRange(unsigned n, bool gray = false) : first(0), gray(gray)
+    {
+        if (n > max_elements)
+        {
+            throw std::length_error("булеан слишком велик: не более 63 элементов");
+        }
+        last = uint64_t{1} << n;
+    }
+
+    // часть булеана: подмножества с порядковыми номерами [first, last)
+    PowerSetRange(uint64_t first, uint64_t last, bool gray) : first(first), last(last), gray(gray) {}
+
+    iterator begin() const
+    {
+        return iterator(first, gray);
+    }
+
+    iterator end() const
+    {
+        return iterator(last, gray);
+    }
+
+    uint64_t size() const
+    {
+        return last - first;
+    }
+};
+
+// Форматирует подмножества в текст "{a, b}" в общий буфер.
+// Элементы переводятся в строки один раз при создании.
+class SubsetFormatter
+{
+private:
+    std::vector<std::string> names;
+
+public:
+    explicit SubsetFormatter(std::vector<std::string> names) : names(std::move(names)) {}
+
+    void append(std::string& buffer, uint64_t mask) const
+    {
+        buffer += '{';
+        bool first = true;
+        while (mask != 0)
+        {
+            if (!first) buffer += ", ";
+            buffer += names[std::countr_zero(mask)];
+            mask &= mask - 1;
+            first = false;
+        }
+        buffer += '}';
+    }
+};
+
+// Пишет подмножества из range в out строками "  {a, b}," (у подмножества с номером
+// total - 1 запятой нет), накапливая текст в буфере и сбрасывая его блоками.
+inline void write_power_set(std::ostream& out, const SubsetFormatter& formatter, const PowerSetRange& range,
+                            uint64_t total)
+{
+    constexpr std::size_t flush_threshold = 1 << 16;
+
+    std::string buffer;
+    buffer.reserve(flush_threshold + 256);
+    for (auto it = range.begin(); it != range.end(); ++it)
+    {
+        buffer += "  ";
+        formatter.append(buffer, *it);
+        if (it.position() + 1 < total) buffer += ',';
+        buffer += '\n';
+        if (buffer.size() >= flush_threshold)
+        {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+#endif //DISCRETE_MATHEMATICS_POWER_SET_H
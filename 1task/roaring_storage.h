@@ -0,0 +1,969 @@
+#ifndef DISCRETE_MATHEMATICS_ROARING_STORAGE_H
+#define DISCRETE_MATHEMATICS_ROARING_STORAGE_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "simd_kernels.h"
+
+// Сжатое хранилище в духе roaring bitmap для целых до 32 бит.
+// Значение делится на старшие 16 бит (ключ куска) и младшие 16 бит (значение внутри
+// куска). Для каждого непустого куска из 65536 значений хранится один контейнер,
+// вид которого выбирается по тому, что занимает меньше памяти:
+//   массив - отсортированные значения, до 4096 штук (2 байта на элемент);
+//   битовая карта - 1024 слова (8 КБ), для плотных кусков;
+//   серии - пары (начало, конец) непрерывных отрезков, по 4 байта на отрезок.
+// Память пропорциональна данным, а не универсуму: пустые куски не хранятся.
+// Операции над парой множеств идут по ключам; над парой контейнеров - слиянием
+// массивов, пересечением отрезков или пословно векторными ядрами (simd_kernels.h).
+template <typename T>
+class RoaringStorage
+{
+    static_assert(std::is_integral_v<T> && sizeof(T) <= 4, "roaring-хранилище поддерживает целые до 32 бит");
+
+public:
+    static constexpr std::size_t array_limit = 4096;
+    static constexpr std::size_t bitmap_words = 65536 / 64;
+
+private:
+    enum class Kind : uint8_t
+    {
+        array,
+        bitmap,
+        runs
+    };
+
+    // Массив: values - значения по возрастанию. Серии: values - пары (начало, конец)
+    // включительно, по возрастанию. Битовая карта: words из bitmap_words слов.
+    struct Container
+    {
+        Kind kind = Kind::array;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> values;
+        std::vector<uint64_t> words;
+    };
+
+    using Words = std::array<uint64_t, bitmap_words>;
+    using Runs = std::vector<std::pair<uint32_t, uint32_t>>;
+
+    std::vector<uint16_t> keys;
+    std::vector<Container> containers;
+    std::size_t count = 0;
+
+    // порядок значений T совпадает с порядком беззнаковых ключей: у знаковых типов
+    // инвертируется знаковый бит
+    static uint32_t encode(T value)
+    {
+        uint32_t x = static_cast<uint32_t>(static_cast<std::make_unsigned_t<T>>(value));
+        if constexpr (std::is_signed_v<T>) x ^= uint32_t{1} << (sizeof(T) * 8 - 1);
+        return x;
+    }
+
+    static T decode(uint32_t x)
+    {
+        if constexpr (std::is_signed_v<T>) x ^= uint32_t{1} << (sizeof(T) * 8 - 1);
+        return static_cast<T>(static_cast<std::make_unsigned_t<T>>(x));
+    }
+
+    // ---------------- один контейнер ----------------
+
+    static bool test(const uint64_t *words, uint32_t low)
+    {
+        return (words[low / 64] >> (low % 64)) & 1;
+    }
+
+    // первая позиция не раньше from, где бит равен value (65536, если такой нет)
+    static uint32_t next_bit(const uint64_t *words, uint32_t from, bool value)
+    {
+        if (from >= 65536) return 65536;
+        std::size_t i = from / 64;
+        uint64_t w = (value ? words[i] : ~words[i]) & (~uint64_t{0} << (from % 64));
+        while (w == 0)
+        {
+            if (++i == bitmap_words) return 65536;
+            w = value ? words[i] : ~words[i];
+        }
+        return static_cast<uint32_t>(i * 64 + std::countr_zero(w));
+    }
+
+    static void set_range(uint64_t *words, uint32_t first, uint32_t last)
+    {
+        for (uint32_t i = first; i <= last;)
+        {
+            uint32_t bit = i % 64;
+            uint32_t span = std::min<uint32_t>(64 - bit, last - i + 1);
+            uint64_t mask = span == 64 ? ~uint64_t{0} : ((uint64_t{1} << span) - 1) << bit;
+            words[i / 64] |= mask;
+            i += span;
+        }
+    }
+
+    // номер серии, которая может содержать low (последняя с началом <= low), или -1
+    static std::ptrdiff_t find_run(const Container& c, uint32_t low)
+    {
+        std::ptrdiff_t lo = 0, hi = static_cast<std::ptrdiff_t>(c.values.size() / 2);
+        while (lo < hi)
+        {
+            std::ptrdiff_t mid = (lo + hi) / 2;
+            if (c.values[2 * mid] <= low) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo - 1;
+    }
+
+    static bool container_contains(const Container& c, uint16_t low)
+    {
+        switch (c.kind)
+        {
+        case Kind::array:
+            return std::binary_search(c.values.begin(), c.values.end(), low);
+        case Kind::bitmap:
+            return test(c.words.data(), low);
+        case Kind::runs:
+        {
+            std::ptrdiff_t run = find_run(c, low);
+            return run >= 0 && low <= c.values[2 * run + 1];
+        }
+        }
+        return false;
+    }
+
+    template <typename F>
+    static void container_for_each(const Container& c, F f)
+    {
+        switch (c.kind)
+        {
+        case Kind::array:
+            for (uint16_t low : c.values) f(low);
+            break;
+        case Kind::bitmap:
+            for (std::size_t i = 0; i < bitmap_words; i++)
+            {
+                for (uint64_t w = c.words[i]; w != 0; w &= w - 1)
+                {
+                    f(static_cast<uint16_t>(i * 64 + std::countr_zero(w)));
+                }
+            }
+            break;
+        case Kind::runs:
+            for (std::size_t r = 0; r < c.values.size(); r += 2)
+            {
+                for (uint32_t low = c.values[r]; low <= c.values[r + 1]; low++) f(static_cast<uint16_t>(low));
+            }
+            break;
+        }
+    }
+
+    static void to_words(const Container& c, uint64_t *words)
+    {
+        std::fill(words, words + bitmap_words, 0);
+        add_to_words(c, words);
+    }
+
+    // words |= элементы контейнера
+    static void add_to_words(const Container& c, uint64_t *words)
+    {
+        if (c.kind == Kind::bitmap)
+        {
+            simd::bitmap_or(words, c.words.data(), words, bitmap_words);
+        }
+        else if (c.kind == Kind::array)
+        {
+            for (uint16_t low : c.values) words[low / 64] |= uint64_t{1} << (low % 64);
+        }
+        else
+        {
+            for (std::size_t r = 0; r < c.values.size(); r += 2) set_range(words, c.values[r], c.values[r + 1]);
+        }
+    }
+
+    static Runs to_runs(const Container& c)
+    {
+        Runs runs;
+        if (c.kind == Kind::runs)
+        {
+            for (std::size_t r = 0; r < c.values.size(); r += 2) runs.emplace_back(c.values[r], c.values[r + 1]);
+            return runs;
+        }
+        container_for_each(c, [&runs](uint16_t low)
+        {
+            if (!runs.empty() && runs.back().second + 1 == low) runs.back().second = low;
+            else runs.emplace_back(low, low);
+        });
+        return runs;
+    }
+
+    // Выбор вида по памяти: массив 2 байта на элемент (не больше array_limit),
+    // серии 4 байта на отрезок, битовая карта 8 КБ.
+    static Kind best_kind(std::size_t cardinality, std::size_t runs)
+    {
+        std::size_t run_bytes = 4 * runs;
+        std::size_t bitmap_bytes = bitmap_words * 8;
+        if (cardinality <= array_limit && 2 * cardinality <= run_bytes) return Kind::array;
+        return run_bytes < bitmap_bytes ? Kind::runs : Kind::bitmap;
+    }
+
+    static Container from_words(const uint64_t *words)
+    {
+        std::size_t runs = 0;
+        std::size_t cardinality = simd::bitmap_count(words, bitmap_words, &runs);
+
+        Container c;
+        c.cardinality = static_cast<uint32_t>(cardinality);
+        c.kind = best_kind(cardinality, runs);
+        if (c.kind == Kind::bitmap)
+        {
+            c.words.assign(words, words + bitmap_words);
+            return c;
+        }
+
+        if (c.kind == Kind::array)
+        {
+            c.values.reserve(cardinality);
+            for (std::size_t i = 0; i < bitmap_words; i++)
+            {
+                for (uint64_t w = words[i]; w != 0; w &= w - 1)
+                {
+                    c.values.push_back(static_cast<uint16_t>(i * 64 + std::countr_zero(w)));
+                }
+            }
+            return c;
+        }
+
+        // серии: границы ищутся по словам, а не по отдельным битам
+        c.values.reserve(2 * runs);
+        uint32_t pos = next_bit(words, 0, true);
+        while (pos < 65536)
+        {
+            uint32_t end = next_bit(words, pos, false);
+            c.values.push_back(static_cast<uint16_t>(pos));
+            c.values.push_back(static_cast<uint16_t>(end - 1));
+            pos = next_bit(words, end, true);
+        }
+        return c;
+    }
+
+    static Container from_runs(const Runs& runs)
+    {
+        std::size_t cardinality = 0;
+        for (const auto& [first, last] : runs) cardinality += last - first + 1;
+
+        Container c;
+        c.cardinality = static_cast<uint32_t>(cardinality);
+        c.kind = best_kind(cardinality, runs.size());
+        if (c.kind == Kind::bitmap)
+        {
+            c.words.assign(bitmap_words, 0);
+            for (const auto& [first, last] : runs) set_range(c.words.data(), first, last);
+        }
+        else if (c.kind == Kind::array)
+        {
+            c.values.reserve(cardinality);
+            for (const auto& [first, last] : runs)
+            {
+                for (uint32_t low = first; low <= last; low++) c.values.push_back(static_cast<uint16_t>(low));
+            }
+        }
+        else
+        {
+            for (const auto& [first, last] : runs)
+            {
+                c.values.push_back(static_cast<uint16_t>(first));
+                c.values.push_back(static_cast<uint16_t>(last));
+            }
+        }
+        return c;
+    }
+
+    static Container from_sorted(std::vector<uint16_t> values)
+    {
+        std::size_t runs = 0;
+        for (std::size_t i = 0; i < values.size(); i++)
+        {
+            if (i == 0 || values[i] != values[i - 1] + 1) runs++;
+        }
+
+        Kind kind = best_kind(values.size(), runs);
+        if (kind == Kind::array)
+        {
+            Container c;
+            c.cardinality = static_cast<uint32_t>(values.size());
+            c.values = std::move(values);
+            return c;
+        }
+        Container source;
+        source.cardinality = static_cast<uint32_t>(values.size());
+        source.values = std::move(values);
+        return from_runs(to_runs(source));
+    }
+
+    // приводит контейнер к самому компактному виду
+    static void normalize(Container& c)
+    {
+        if (c.kind == Kind::bitmap) c = from_words(c.words.data());
+        else if (c.kind == Kind::array) c = from_sorted(std::move(c.values));
+        else c = from_runs(to_runs(c));
+    }
+
+    static bool container_insert(Container& c, uint16_t low)
+    {
+        switch (c.kind)
+        {
+        case Kind::array:
+        {
+            auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+            if (it != c.values.end() && *it == low) return false;
+            if (c.values.size() < array_limit)
+            {
+                c.values.insert(it, low);
+                break;
+            }
+            Words words;
+            to_words(c, words.data());
+            c.kind = Kind::bitmap;
+            c.words.assign(words.begin(), words.end());
+            std::vector<uint16_t>().swap(c.values);
+            c.words[low / 64] |= uint64_t{1} << (low % 64);
+            break;
+        }
+        case Kind::bitmap:
+            if (test(c.words.data(), low)) return false;
+            c.words[low / 64] |= uint64_t{1} << (low % 64);
+            break;
+        case Kind::runs:
+        {
+            std::ptrdiff_t run = find_run(c, low);
+            if (run >= 0 && low <= c.values[2 * run + 1]) return false;
+            bool joins_prev = run >= 0 && c.values[2 * run + 1] + 1 == low;
+            std::size_t next = static_cast<std::size_t>(run + 1);
+            bool joins_next = 2 * next < c.values.size() && c.values[2 * next] == low + 1;
+            if (joins_prev && joins_next)
+            {
+                c.values[2 * run + 1] = c.values[2 * next + 1];
+                c.values.erase(c.values.begin() + 2 * next, c.values.begin() + 2 * next + 2);
+            }
+            else if (joins_prev)
+            {
+                c.values[2 * run + 1] = low;
+            }
+            else if (joins_next)
+            {
+                c.values[2 * next] = low;
+            }
+            else
+            {
+                c.values.insert(c.values.begin() + 2 * next, {low, low});
+                // серий стало больше, чем помещается в битовую карту того же размера
+                if (c.values.size() * sizeof(uint16_t) > bitmap_words * sizeof(uint64_t))
+                {
+                    Words words;
+                    to_words(c, words.data());
+                    c.kind = Kind::bitmap;
+                    c.words.assign(words.begin(), words.end());
+                    std::vector<uint16_t>().swap(c.values);
+                }
+            }
+            break;
+        }
+        }
+        c.cardinality++;
+        return true;
+    }
+
+    static bool container_erase(Container& c, uint16_t low)
+    {
+        switch (c.kind)
+        {
+        case Kind::array:
+        {
+            auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+            if (it == c.values.end() || *it != low) return false;
+            c.values.erase(it);
+            c.cardinality--;
+            return true;
+        }
+        case Kind::bitmap:
+            if (!test(c.words.data(), low)) return false;
+            c.words[low / 64] &= ~(uint64_t{1} << (low % 64));
+            // как в roaring: карта, ставшая не больше array_limit, превращается в массив
+            if (--c.cardinality <= array_limit) normalize(c);
+            return true;
+        case Kind::runs:
+        {
+            std::ptrdiff_t run = find_run(c, low);
+            if (run < 0 || low > c.values[2 * run + 1]) return false;
+            uint16_t first = c.values[2 * run], last = c.values[2 * run + 1];
+            if (first == last)
+            {
+                c.values.erase(c.values.begin() + 2 * run, c.values.begin() + 2 * run + 2);
+            }
+            else if (low == first)
+            {
+                c.values[2 * run] = static_cast<uint16_t>(low + 1);
+            }
+            else if (low == last)
+            {
+                c.values[2 * run + 1] = static_cast<uint16_t>(low - 1);
+            }
+            else
+            {
+                c.values[2 * run + 1] = static_cast<uint16_t>(low - 1);
+                c.values.insert(c.values.begin() + 2 * run + 2, {static_cast<uint16_t>(low + 1), last});
+            }
+            c.cardinality--;
+            return true;
+        }
+        }
+        return false;
+    }
+
+    enum class Op
+    {
+        unite,
+        intersect,
+        subtract,
+        sym_difference
+    };
+
+    static Runs combine_runs(const Runs& a, const Runs& b, Op op)
+    {
+        Runs out;
+        std::size_t i = 0, j = 0;
+        if (op == Op::unite)
+        {
+            while (i < a.size() || j < b.size())
+            {
+                auto next = j == b.size() || (i < a.size() && a[i].first <= b[j].first) ? a[i++] : b[j++];
+                if (!out.empty() && next.first <= out.back().second + 1)
+                {
+                    out.back().second = std::max(out.back().second, next.second);
+                }
+                else
+                {
+                    out.push_back(next);
+                }
+            }
+        }
+        else if (op == Op::intersect)
+        {
+            while (i < a.size() && j < b.size())
+            {
+                uint32_t first = std::max(a[i].first, b[j].first);
+                uint32_t last = std::min(a[i].second, b[j].second);
+                if (first <= last) out.emplace_back(first, last);
+                if (a[i].second < b[j].second) i++;
+                else j++;
+            }
+        }
+        else
+        {
+            for (auto [first, last] : a)
+            {
+                while (j < b.size() && b[j].second < first) j++;
+                for (std::size_t k = j; k < b.size() && b[k].first <= last; k++)
+                {
+                    if (b[k].first > first) out.emplace_back(first, b[k].first - 1);
+                    first = b[k].second + 1;
+                    if (first > last) break;
+                }
+                if (first <= last) out.emplace_back(first, last);
+            }
+        }
+        return out;
+    }
+
+    static std::vector<uint16_t> combine_arrays(const std::vector<uint16_t>& a, const std::vector<uint16_t>& b, Op op)
+    {
+        std::vector<uint16_t> out;
+        if (op == Op::unite)
+        {
+            out.reserve(a.size() + b.size());
+            std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        }
+        else if (op == Op::intersect)
+        {
+            out.reserve(std::min(a.size(), b.size()));
+            std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        }
+        else if (op == Op::sym_difference)
+        {
+            out.reserve(a.size() + b.size());
+            std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        }
+        else
+        {
+            out.reserve(a.size());
+            std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        }
+        return out;
+    }
+
+    // результат операции над двумя контейнерами одного ключа, уже в компактном виде
+    static Container combine(const Container& a, const Container& b, Op op)
+    {
+        if (a.kind == Kind::bitmap || b.kind == Kind::bitmap)
+        {
+            Words wa, wb, out;
+            const uint64_t *pa = a.words.data(), *pb = b.words.data();
+            if (a.kind != Kind::bitmap)
+            {
+                to_words(a, wa.data());
+                pa = wa.data();
+            }
+            if (b.kind != Kind::bitmap)
+            {
+                to_words(b, wb.data());
+                pb = wb.data();
+            }
+            if (op == Op::unite) simd::bitmap_or(pa, pb, out.data(), bitmap_words);
+            else if (op == Op::intersect) simd::bitmap_and(pa, pb, out.data(), bitmap_words);
+            else if (op == Op::subtract) simd::bitmap_andnot(pa, pb, out.data(), bitmap_words);
+            else simd::bitmap_xor(pa, pb, out.data(), bitmap_words);
+            return from_words(out.data());
+        }
+        if (a.kind == Kind::array && b.kind == Kind::array)
+        {
+            return from_sorted(combine_arrays(a.values, b.values, op));
+        }
+        Runs ra = to_runs(a), rb = to_runs(b);
+        if (op == Op::sym_difference)
+        {
+            // (a ∪ b) \ (a ∩ b)
+            return from_runs(combine_runs(combine_runs(ra, rb, Op::unite), combine_runs(ra, rb, Op::intersect),
+                                          Op::subtract));
+        }
+        return from_runs(combine_runs(ra, rb, op));
+    }
+
+    // Пересечение контейнеров одного ключа (group упорядочена по мощности): малый массив
+    // сужается по остальным (слиянием с массивами, поиском в картах и сериях), серии
+    // пересекаются как отрезки,
+    // иначе все контейнеры сворачиваются AND в одну битовую карту.
+    static Container intersect_group(const std::vector<const Container*>& group)
+    {
+        const Container& smallest = *group.front();
+        if (smallest.kind == Kind::array)
+        {
+            std::vector<uint16_t> values = smallest.values;
+            for (std::size_t k = 1; k < group.size() && !values.empty(); k++)
+            {
+                const Container& other = *group[k];
+                if (other.kind == Kind::array)
+                {
+                    values = combine_arrays(values, other.values, Op::intersect);
+                }
+                else
+                {
+                    std::erase_if(values, [&other](uint16_t low) { return !container_contains(other, low); });
+                }
+            }
+            return from_sorted(std::move(values));
+        }
+        if (std::all_of(group.begin(), group.end(), [](const Container *c) { return c->kind == Kind::runs; }))
+        {
+            Runs runs = to_runs(smallest);
+            for (std::size_t k = 1; k < group.size() && !runs.empty(); k++)
+            {
+                runs = combine_runs(runs, to_runs(*group[k]), Op::intersect);
+            }
+            return from_runs(runs);
+        }
+
+        Words acc, part;
+        to_words(smallest, acc.data());
+        for (std::size_t k = 1; k < group.size(); k++)
+        {
+            const uint64_t *words = group[k]->words.data();
+            if (group[k]->kind != Kind::bitmap)
+            {
+                to_words(*group[k], part.data());
+                words = part.data();
+            }
+            simd::bitmap_and(acc.data(), words, acc.data(), bitmap_words);
+        }
+        return from_words(acc.data());
+    }
+
+    static bool container_is_subset(const Container& a, const Container& b)
+    {
+        if (a.cardinality > b.cardinality) return false;
+        if (a.kind == Kind::array)
+        {
+            return std::all_of(a.values.begin(), a.values.end(),
+                               [&b](uint16_t low) { return container_contains(b, low); });
+        }
+        if (a.kind == Kind::runs && b.kind == Kind::runs)
+        {
+            return combine_runs(to_runs(a), to_runs(b), Op::subtract).empty();
+        }
+
+        Words wa, wb;
+        const uint64_t *pa = a.words.data(), *pb = b.words.data();
+        if (a.kind != Kind::bitmap)
+        {
+            to_words(a, wa.data());
+            pa = wa.data();
+        }
+        if (b.kind != Kind::bitmap)
+        {
+            to_words(b, wb.data());
+            pb = wb.data();
+        }
+        return simd::bitmap_is_subset(pa, pb, bitmap_words);
+    }
+
+    // |a ∩ b| без построения контейнера: массив проверяется поэлементно, серии
+    // пересекаются как отрезки, остальное - popcount(a & b) по словам карты
+    static std::size_t container_intersect_count(const Container& a, const Container& b)
+    {
+        if (a.kind == Kind::array && b.kind == Kind::array)
+        {
+            std::size_t i = 0, j = 0, result = 0;
+            while (i < a.values.size() && j < b.values.size())
+            {
+                uint16_t x = a.values[i], y = b.values[j];
+                result += x == y;
+                i += x <= y;
+                j += y <= x;
+            }
+            return result;
+        }
+        if (a.kind == Kind::array || b.kind == Kind::array)
+        {
+            const Container& small = a.kind == Kind::array ? a : b;
+            const Container& other = a.kind == Kind::array ? b : a;
+            return static_cast<std::size_t>(std::count_if(small.values.begin(), small.values.end(),
+                                                          [&other](uint16_t low) { return container_contains(other, low); }));
+        }
+        if (a.kind == Kind::runs && b.kind == Kind::runs)
+        {
+            std::size_t i = 0, j = 0, result = 0;
+            while (i < a.values.size() && j < b.values.size())
+            {
+                uint32_t lo = std::max(a.values[i], b.values[j]), hi = std::min(a.values[i + 1], b.values[j + 1]);
+                if (lo <= hi) result += hi - lo + 1;
+                if (a.values[i + 1] < b.values[j + 1]) i += 2;
+                else j += 2;
+            }
+            return result;
+        }
+
+        Words wa, wb;
+        const uint64_t *pa = a.words.data(), *pb = b.words.data();
+        if (a.kind != Kind::bitmap)
+        {
+            to_words(a, wa.data());
+            pa = wa.data();
+        }
+        if (b.kind != Kind::bitmap)
+        {
+            to_words(b, wb.data());
+            pb = wb.data();
+        }
+        return simd::bitmap_and_count(pa, pb, bitmap_words);
+    }
+
+    // ---------------- набор контейнеров ----------------
+
+    std::ptrdiff_t find_key(uint16_t key) const
+    {
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        return it != keys.end() && *it == key ? it - keys.begin() : -1;
+    }
+
+    void push_container(uint16_t key, Container c)
+    {
+        if (c.cardinality == 0) return;
+        count += c.cardinality;
+        keys.push_back(key);
+        containers.push_back(std::move(c));
+    }
+
+    template <typename OnlyA, typename OnlyB>
+    static void merge_keys(const RoaringStorage& a, const RoaringStorage& b, RoaringStorage& out, Op op,
+                           OnlyA only_a, OnlyB only_b)
+    {
+        RoaringStorage result;
+        std::size_t i = 0, j = 0;
+        while (i < a.keys.size() || j < b.keys.size())
+        {
+            if (j == b.keys.size() || (i < a.keys.size() && a.keys[i] < b.keys[j]))
+            {
+                if (only_a) result.push_container(a.keys[i], a.containers[i]);
+                i++;
+            }
+            else if (i == a.keys.size() || b.keys[j] < a.keys[i])
+            {
+                if (only_b) result.push_container(b.keys[j], b.containers[j]);
+                j++;
+            }
+            else
+            {
+                result.push_container(a.keys[i], combine(a.containers[i], b.containers[j], op));
+                i++;
+                j++;
+            }
+        }
+        out = std::move(result);
+    }
+
+public:
+    bool contains(T value) const
+    {
+        uint32_t x = encode(value);
+        std::ptrdiff_t i = find_key(static_cast<uint16_t>(x >> 16));
+        return i >= 0 && container_contains(containers[i], static_cast<uint16_t>(x));
+    }
+
+    bool insert(T value)
+    {
+        uint32_t x = encode(value);
+        uint16_t key = static_cast<uint16_t>(x >> 16);
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        std::size_t i = static_cast<std::size_t>(it - keys.begin());
+        if (it == keys.end() || *it != key)
+        {
+            keys.insert(it, key);
+            containers.insert(containers.begin() + static_cast<std::ptrdiff_t>(i), Container{});
+        }
+        if (!container_insert(containers[i], static_cast<uint16_t>(x))) return false;
+        count++;
+        return true;
+    }
+
+    bool erase(T value)
+    {
+        uint32_t x = encode(value);
+        std::ptrdiff_t i = find_key(static_cast<uint16_t>(x >> 16));
+        if (i < 0 || !container_erase(containers[i], static_cast<uint16_t>(x))) return false;
+        if (containers[i].cardinality == 0)
+        {
+            keys.erase(keys.begin() + i);
+            containers.erase(containers.begin() + i);
+        }
+        count--;
+        return true;
+    }
+
+    void clear()
+    {
+        keys.clear();
+        containers.clear();
+        count = 0;
+    }
+
+    void reserve(std::size_t)
+    {
+    }
+
+    // value больше всех уже добавленных: дописывается в последний контейнер,
+    // закрытый контейнер сразу приводится к компактному виду
+    void append_sorted(T value)
+    {
+        uint32_t x = encode(value);
+        uint16_t key = static_cast<uint16_t>(x >> 16);
+        if (keys.empty() || keys.back() != key)
+        {
+            if (!containers.empty()) normalize(containers.back());
+            keys.push_back(key);
+            containers.emplace_back();
+        }
+
+        Container& c = containers.back();
+        uint16_t low = static_cast<uint16_t>(x);
+        if (c.kind == Kind::array && c.values.size() < array_limit)
+        {
+            c.values.push_back(low);
+            c.cardinality++;
+        }
+        else
+        {
+            container_insert(c, low);
+        }
+        count++;
+    }
+
+    // приводит все контейнеры к самому компактному виду (после построения)
+    void optimize()
+    {
+        for (Container& c : containers) normalize(c);
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    std::size_t size() const
+    {
+        return count;
+    }
+
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (std::size_t i = 0; i < keys.size(); i++)
+        {
+            uint32_t high = uint32_t{keys[i]} << 16;
+            container_for_each(containers[i], [&](uint16_t low) { f(decode(high | low)); });
+        }
+    }
+
+    // байт памяти под данные контейнеров
+    std::size_t memory_usage() const
+    {
+        std::size_t bytes = keys.capacity() * sizeof(uint16_t) + containers.capacity() * sizeof(Container);
+        for (const Container& c : containers)
+        {
+            bytes += c.values.capacity() * sizeof(uint16_t) + c.words.capacity() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+public:
+    static void unite(const RoaringStorage& a, const RoaringStorage& b, RoaringStorage& out)
+    {
+        merge_keys(a, b, out, Op::unite, true, true);
+    }
+
+    static void intersect(const RoaringStorage& a, const RoaringStorage& b, RoaringStorage& out)
+    {
+        merge_keys(a, b, out, Op::intersect, false, false);
+    }
+
+    static void subtract(const RoaringStorage& a, const RoaringStorage& b, RoaringStorage& out)
+    {
+        merge_keys(a, b, out, Op::subtract, true, false);
+    }
+
+    static void sym_difference(const RoaringStorage& a, const RoaringStorage& b, RoaringStorage& out)
+    {
+        merge_keys(a, b, out, Op::sym_difference, true, true);
+    }
+
+    // Объединение любого числа множеств: контейнеры группируются по ключу, и каждая
+    // группа сливается за один раз - малые в массив, большие в одну битовую карту.
+    static void unite_all(std::span<const RoaringStorage* const> sets, RoaringStorage& out)
+    {
+        struct Ref
+        {
+            uint16_t key;
+            const Container *container;
+        };
+        std::vector<Ref> refs;
+        for (const RoaringStorage *set : sets)
+        {
+            for (std::size_t i = 0; i < set->keys.size(); i++) refs.push_back({set->keys[i], &set->containers[i]});
+        }
+        std::stable_sort(refs.begin(), refs.end(), [](const Ref& x, const Ref& y) { return x.key < y.key; });
+
+        RoaringStorage result;
+        for (std::size_t first = 0, last = 0; first < refs.size(); first = last)
+        {
+            std::size_t total = 0;
+            for (last = first; last < refs.size() && refs[last].key == refs[first].key; last++)
+            {
+                total += refs[last].container->cardinality;
+            }
+            if (last - first == 1)
+            {
+                result.push_container(refs[first].key, *refs[first].container);
+            }
+            else if (total <= array_limit)
+            {
+                std::vector<uint16_t> values;
+                values.reserve(total);
+                for (std::size_t k = first; k < last; k++)
+                {
+                    container_for_each(*refs[k].container, [&values](uint16_t low) { values.push_back(low); });
+                }
+                std::sort(values.begin(), values.end());
+                values.erase(std::unique(values.begin(), values.end()), values.end());
+                result.push_container(refs[first].key, from_sorted(std::move(values)));
+            }
+            else
+            {
+                Words words{};
+                for (std::size_t k = first; k < last; k++) add_to_words(*refs[k].container, words.data());
+                result.push_container(refs[first].key, from_words(words.data()));
+            }
+        }
+        out = std::move(result);
+    }
+
+    // Пересечение: ключи наименьшего множества ищутся в остальных, контейнеры одного
+    // ключа пересекаются от меньших к большим до первого пустого результата.
+    static void intersect_all(std::span<const RoaringStorage* const> sets, RoaringStorage& out)
+    {
+        std::vector<const RoaringStorage*> order(sets.begin(), sets.end());
+        std::sort(order.begin(), order.end(),
+                  [](const RoaringStorage *x, const RoaringStorage *y) { return x->count < y->count; });
+
+        RoaringStorage result;
+        std::vector<const Container*> group;
+        const RoaringStorage& smallest = *order.front();
+        for (std::size_t i = 0; i < smallest.keys.size(); i++)
+        {
+            group.assign(1, &smallest.containers[i]);
+            for (std::size_t k = 1; k < order.size(); k++)
+            {
+                std::ptrdiff_t j = order[k]->find_key(smallest.keys[i]);
+                if (j < 0) break;
+                group.push_back(&order[k]->containers[j]);
+            }
+            if (group.size() != order.size()) continue;
+
+            std::sort(group.begin(), group.end(),
+                      [](const Container *x, const Container *y) { return x->cardinality < y->cardinality; });
+            result.push_container(smallest.keys[i], intersect_group(group));
+        }
+        out = std::move(result);
+    }
+
+    static bool is_subset(const RoaringStorage& a, const RoaringStorage& b)
+    {
+        if (a.count > b.count) return false;
+        for (std::size_t i = 0; i < a.keys.size(); i++)
+        {
+            std::ptrdiff_t j = b.find_key(a.keys[i]);
+            if (j < 0 || !container_is_subset(a.containers[i], b.containers[j])) return false;
+        }
+        return true;
+    }
+
+    static bool equal(const RoaringStorage& a, const RoaringStorage& b)
+    {
+        if (a.count != b.count || a.keys != b.keys) return false;
+        for (std::size_t i = 0; i < a.keys.size(); i++)
+        {
+            if (a.containers[i].cardinality != b.containers[i].cardinality ||
+                !container_is_subset(a.containers[i], b.containers[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static std::size_t intersect_count(const RoaringStorage& a, const RoaringStorage& b)
+    {
+        std::size_t result = 0, i = 0, j = 0;
+        while (i < a.keys.size() && j < b.keys.size())
+        {
+            if (a.keys[i] < b.keys[j]) i++;
+            else if (b.keys[j] < a.keys[i]) j++;
+            else result += container_intersect_count(a.containers[i++], b.containers[j++]);
+        }
+        return result;
+    }
+};
+
+#endif //DISCRETE_MATHEMATICS_ROARING_STORAGE_H
@@ -0,0 +1,235 @@
+#ifndef DISCRETE_MATHEMATICS_SET_EXPRESSION_H
+#define DISCRETE_MATHEMATICS_SET_EXPRESSION_H
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Составное выражение над именованными множествами: (A + B) & (C - D) ^ E.
+// Приоритет: & выше, чем +, - и ^ (симметрическая разность), все операции
+// левоассоциативны.
+// Выражение компилируется в постфиксную программу; вычисление идёт один раз по
+// позициям операндов (по словам битовой карты или по элементам) на стеке
+// фиксированного размера, поэтому промежуточные множества не создаются.
+enum class SetOp : uint8_t
+{
+    operand,
+    unite,
+    intersect,
+    subtract,
+    sym_difference
+};
+
+struct ExprStep
+{
+    SetOp op;
+    std::size_t operand; // номер операнда для SetOp::operand
+};
+
+class SetExpression
+{
+public:
+    static constexpr std::size_t max_depth = 64;
+
+private:
+    std::vector<std::string> operands;
+    std::vector<ExprStep> program;
+
+    // рекурсивный спуск: expr := term (('+' | '-' | '^') term)*, term := atom ('&' atom)*,
+    // atom := имя | '(' expr ')'
+    class Parser
+    {
+    private:
+        std::string_view text;
+        std::size_t pos = 0;
+        SetExpression& expr;
+        std::size_t depth = 0; // высота стека вычисления в текущей точке программы
+
+        void skip_spaces()
+        {
+            while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+        }
+
+        char peek()
+        {
+            skip_spaces();
+            return pos < text.size() ? text[pos] : '\0';
+        }
+
+        void push_operand()
+        {
+            if (++depth > max_depth)
+            {
+                throw std::invalid_argument("выражение слишком глубокое");
+            }
+        }
+
+        void parse_atom()
+        {
+            char c = peek();
+            if (c == '(')
+            {
+                pos++;
+                parse_expr();
+                if (peek() != ')')
+                {
+                    throw std::invalid_argument("ожидалась ')'");
+                }
+                pos++;
+                return;
+            }
+
+            std::size_t start = pos;
+            while (pos < text.size() &&
+                   (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_'))
+            {
+                pos++;
+            }
+            if (start == pos || !std::isalpha(static_cast<unsigned char>(text[start])))
+            {
+                throw std::invalid_argument("ожидалось имя множества");
+            }
+
+            std::string name(text.substr(start, pos - start));
+            auto it = std::find(expr.operands.begin(), expr.operands.end(), name);
+            std::size_t index = static_cast<std::size_t>(it - expr.operands.begin());
+            if (it == expr.operands.end()) expr.operands.push_back(std::move(name));
+            expr.program.push_back({SetOp::operand, index});
+            push_operand();
+        }
+
+        void parse_term()
+        {
+            parse_atom();
+            while (peek() == '&')
+            {
+                pos++;
+                parse_atom();
+                expr.program.push_back({SetOp::intersect, 0});
+                depth--;
+            }
+        }
+
+        void parse_expr()
+        {
+            parse_term();
+            for (char c = peek(); c == '+' || c == '-' || c == '^'; c = peek())
+            {
+                pos++;
+                parse_term();
+                expr.program.push_back({c == '+' ? SetOp::unite : c == '-' ? SetOp::subtract : SetOp::sym_difference, 0});
+                depth--;
+            }
+        }
+
+    public:
+        Parser(std::string_view text, SetExpression& expr) : text(text), expr(expr) {}
+
+        void run()
+        {
+            parse_expr();
+            if (peek() != '\0')
+            {
+                throw std::invalid_argument("лишние символы в выражении: " + std::string(text.substr(pos)));
+            }
+        }
+    };
+
+public:
+    static SetExpression parse(std::string_view text)
+    {
+        SetExpression expr;
+        Parser(text, expr).run();
+        return expr;
+    }
+
+    const std::vector<std::string>& operand_names() const
+    {
+        return operands;
+    }
+
+    const std::vector<ExprStep>& steps() const
+    {
+        return program;
+    }
+
+    // Значение выражения в одной позиции: load(i) даёт значение i-го операнда.
+    // W = uint64_t - слово битовой карты, W = bool - принадлежность одного элемента.
+    template <typename W, typename Load>
+    W eval(Load load) const
+    {
+        std::array<W, max_depth> stack;
+        std::size_t top = 0;
+        for (const ExprStep& step : program)
+        {
+            if (step.op == SetOp::operand)
+            {
+                stack[top++] = load(step.operand);
+                continue;
+            }
+
+            W rhs = stack[--top];
+            W& lhs = stack[top - 1];
+            if constexpr (std::is_same_v<W, bool>)
+            {
+                if (step.op == SetOp::unite) lhs = lhs || rhs;
+                else if (step.op == SetOp::intersect) lhs = lhs && rhs;
+                else if (step.op == SetOp::subtract) lhs = lhs && !rhs;
+                else lhs = lhs != rhs;
+            }
+            else
+            {
+                if (step.op == SetOp::unite) lhs |= rhs;
+                else if (step.op == SetOp::intersect) lhs &= rhs;
+                else if (step.op == SetOp::subtract) lhs &= ~rhs;
+                else lhs ^= rhs;
+            }
+        }
+        return stack[0];
+    }
+
+    // запись выражения в математической нотации: (A ∪ B) ∩ (C \ D) △ E
+    std::string to_string() const
+    {
+        struct Part
+        {
+            std::string text;
+            int level; // 2 - имя или скобки, 1 - пересечение, 0 - объединение/разности
+            SetOp op;
+        };
+        std::vector<Part> stack;
+        for (const ExprStep& step : program)
+        {
+            if (step.op == SetOp::operand)
+            {
+                stack.push_back({operands[step.operand], 2, SetOp::operand});
+                continue;
+            }
+
+            Part rhs = std::move(stack.back());
+            stack.pop_back();
+            Part& lhs = stack.back();
+
+            int level = step.op == SetOp::intersect ? 1 : 0;
+            const char *sign = step.op == SetOp::unite       ? " ∪ "
+                             : step.op == SetOp::intersect ? " ∩ "
+                             : step.op == SetOp::subtract  ? " \\ "
+                                                           : " △ ";
+            if (lhs.level < level || (lhs.level == level && lhs.op != step.op)) lhs.text = "(" + lhs.text + ")";
+            if (rhs.level <= level) rhs.text = "(" + rhs.text + ")";
+            lhs.text += sign + rhs.text;
+            lhs.level = level;
+            lhs.op = step.op;
+        }
+        return stack.empty() ? std::string() : stack.back().text;
+    }
+};
+
+#endif //DISCRETE_MATHEMATICS_SET_EXPRESSION_H
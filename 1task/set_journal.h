@@ -0,0 +1,550 @@
+#ifndef DISCRETE_MATHEMATICS_SET_JOURNAL_H
+#define DISCRETE_MATHEMATICS_SET_JOURNAL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "snapshot.h"
+
+// Журнал операций над множествами реестра.
+//
+//   JournalHeader                       заголовок (16 байт)
+//   записи подряд: JournalRecordHeader (8 байт), имя множества, count элементов T
+//
+// Журнал только дописывается: отмена операции пишется в него как обратная операция,
+// поэтому повтор журнала с начала всегда даёт текущее состояние. Сжатие сохраняет
+// реестр в снимок (snapshot.h) и заменяет журнал одной записью base_snapshot.
+// Повтор применяет подряд идущие add одного множества пачкой через add_all.
+// Отмена и повтор (undo/redo) - O(1) для add/rem: хранится ограниченная история
+// обратимых записей в памяти, и обратная операция выполняется сразу, без повтора журнала.
+
+struct JournalHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t element_size; // sizeof(T)
+};
+
+struct JournalRecordHeader
+{
+    uint8_t op; // JournalOp
+    uint8_t reserved;
+    uint16_t name_length;
+    uint32_t count; // элементов T после имени
+};
+
+static_assert(sizeof(JournalHeader) == 16 && sizeof(JournalRecordHeader) == 8, "формат журнала фиксирован");
+
+enum class JournalOp : uint8_t
+{
+    create = 1,       // новое множество с элементами (new - без элементов, результат слияния - с ними)
+    drop = 2,         // удаление множества
+    add = 3,          // один элемент
+    remove = 4,       // один элемент
+    base_snapshot = 5 // вместо имени - файл снимка (в каталоге журнала), с которого начинается журнал
+};
+
+inline constexpr char journal_magic[8] = {'S', 'E', 'T', 'J', 'R', 'N', 'L', '1'};
+inline constexpr uint32_t journal_version = 1;
+
+template <typename SetT>
+class SetJournal
+{
+public:
+    using T = typename SetT::value_type;
+    static_assert(std::is_trivially_copyable_v<T>, "в журнал пишутся только тривиально копируемые элементы");
+
+private:
+    struct Entry
+    {
+        JournalOp op;
+        std::string name;
+        T value{};               // add / remove
+        std::vector<T> elements; // create / drop: содержимое множества для обратной операции
+    };
+
+    std::deque<Entry> undo_history;
+    std::vector<Entry> redo_history;
+    std::size_t history_limit;
+
+    std::FILE *file = nullptr;
+    std::string path;
+    std::string base_snapshot;     // файл снимка, с которого начинается журнал (пусто - без снимка)
+    std::size_t compact_every = 0; // 0 - сжимать только по вызову compact()
+    std::size_t appended = 0;      // записей с последнего сжатия
+
+public:
+    explicit SetJournal(std::size_t history_limit = 4096) : history_limit(history_limit) {}
+
+    SetJournal(const SetJournal&) = delete;
+    SetJournal& operator=(const SetJournal&) = delete;
+
+    ~SetJournal()
+    {
+        if (file != nullptr) std::fclose(file);
+    }
+
+    // Подключает файл журнала: существующий повторяется в реестр, затем в него
+    // дописываются новые операции. Недописанная последняя запись (обрыв при записи)
+    // отбрасывается; файл, оборванный внутри заголовка, считается пустым и создаётся заново.
+    // compact_every - сжатие после стольких записей (0 - не сжимать), см. compact_if_due.
+    // Возвращает число повторённых записей.
+    std::size_t open(const std::string& journal_path, std::size_t compact_every_records = 0)
+    {
+        if (file != nullptr)
+        {
+            throw std::logic_error("журнал уже открыт");
+        }
+
+        std::size_t replayed = 0;
+        std::error_code error;
+        std::uintmax_t size = std::filesystem::exists(journal_path, error)
+                              ? std::filesystem::file_size(journal_path, error) : 0;
+        if (size != 0 && !torn_header(journal_path, size))
+        {
+            uint64_t valid = 0;
+            replayed = replay(journal_path, &valid, &base_snapshot);
+            if (valid != std::filesystem::file_size(journal_path)) std::filesystem::resize_file(journal_path, valid);
+            file = std::fopen(journal_path.c_str(), "ab");
+        }
+        else
+        {
+            file = create_file(journal_path);
+        }
+        if (file == nullptr)
+        {
+            throw std::runtime_error("не удалось открыть журнал " + journal_path);
+        }
+
+        path = journal_path;
+        compact_every = compact_every_records;
+        appended = replayed;
+        return replayed;
+    }
+
+    bool is_open() const
+    {
+        return file != nullptr;
+    }
+
+    // сбрасывает буфер stdio в файл; ошибка записи, отложенная буфером, всплывает здесь
+    void flush()
+    {
+        if (file == nullptr) return;
+        if (std::fflush(file) != 0 || std::ferror(file))
+        {
+            throw std::runtime_error("ошибка записи в файл " + path);
+        }
+    }
+
+public:
+    // Операции REPL: выполняют изменение, пишут его в журнал и запоминают для undo.
+    SetT* create(const std::string& name)
+    {
+        SetT *set = new SetT(name);
+        record({JournalOp::create, name, T{}, {}});
+        return set;
+    }
+
+    // множество уже создано (слиянием, выражением, загрузкой) - запомнить его содержимое
+    void note_created(const SetT& set)
+    {
+        record({JournalOp::create, set.get_name(), T{}, contents(set)});
+    }
+
+    void drop(SetT& set)
+    {
+        Entry entry{JournalOp::drop, set.get_name(), T{}, contents(set)};
+        SetT::retire(&set);
+        record(std::move(entry));
+    }
+
+    // возвращают SetStatus, как try_add / try_remove
+    auto add(SetT& set, const T& value)
+    {
+        auto status = set.try_add(value);
+        if (status == decltype(status)::ok) record({JournalOp::add, set.get_name(), value, {}});
+        return status;
+    }
+
+    auto remove(SetT& set, const T& value)
+    {
+        auto status = set.try_remove(value);
+        if (status == decltype(status)::ok) record({JournalOp::remove, set.get_name(), value, {}});
+        return status;
+    }
+
+public:
+    // Отменяет последнюю операцию обратной (add <-> remove, create <-> drop).
+    // Возвращает false, если отменять нечего.
+    bool undo()
+    {
+        if (undo_history.empty()) return false;
+        Entry& entry = undo_history.back();
+        const JournalOp op = inverse(entry.op);
+        execute(op, entry); // исключение - до изменения реестра, история не меняется
+        redo_history.push_back(std::move(entry));
+        undo_history.pop_back();
+        append(op, redo_history.back());
+        return true;
+    }
+
+    bool redo()
+    {
+        if (redo_history.empty()) return false;
+        Entry& entry = redo_history.back();
+        const JournalOp op = entry.op;
+        execute(op, entry);
+        undo_history.push_back(std::move(entry));
+        redo_history.pop_back();
+        append(op, undo_history.back());
+        trim_history();
+        return true;
+    }
+
+    std::size_t undo_depth() const
+    {
+        return undo_history.size();
+    }
+
+    std::size_t redo_depth() const
+    {
+        return redo_history.size();
+    }
+
+public:
+    // Сохраняет реестр в снимок и начинает журнал заново с записи о нём. Снимок
+    // пишется под именем, на которое текущий журнал не ссылается (<журнал>.snap и
+    // <журнал>.alt.snap по очереди), новый журнал - во временный файл, который
+    // подменяет старый. Старый журнал остаётся открытым, пока подмена не удалась,
+    // поэтому при любой ошибке журнал и его снимок остаются прежними.
+    void compact()
+    {
+        if (file == nullptr)
+        {
+            throw std::logic_error("журнал не открыт");
+        }
+
+        const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+        const std::string journal_name = std::filesystem::path(path).filename().string();
+        const std::string snapshot_name =
+            journal_name + (base_snapshot == journal_name + ".snap" ? ".alt.snap" : ".snap");
+        const std::string snapshot_path = (directory / snapshot_name).string();
+        const std::string temp_path = path + ".tmp";
+
+        std::FILE *fresh = nullptr;
+        try
+        {
+            SetT::save_snapshot(snapshot_path);
+            fresh = create_file(temp_path);
+            if (fresh == nullptr)
+            {
+                throw std::runtime_error("не удалось открыть файл " + temp_path);
+            }
+            // путь к снимку пишется относительно каталога журнала
+            write_record(fresh, temp_path, JournalOp::base_snapshot, snapshot_name, {});
+            if (std::fflush(fresh) != 0)
+            {
+                throw std::runtime_error("ошибка записи в файл " + temp_path);
+            }
+            // открытый fresh после переименования пишет уже в новый журнал
+            std::error_code error;
+            std::filesystem::rename(temp_path, path, error);
+            if (error)
+            {
+                throw std::runtime_error("не удалось заменить журнал " + path);
+            }
+        }
+        catch (...)
+        {
+            std::error_code ignored;
+            if (fresh != nullptr)
+            {
+                std::fclose(fresh);
+                std::filesystem::remove(temp_path, ignored);
+            }
+            std::filesystem::remove(snapshot_path, ignored);
+            throw;
+        }
+
+        std::fclose(file);
+        file = fresh;
+        if (!base_snapshot.empty() && base_snapshot != snapshot_name)
+        {
+            std::error_code ignored;
+            std::filesystem::remove(directory / base_snapshot, ignored);
+        }
+        base_snapshot = snapshot_name;
+        appended = 0;
+    }
+
+    // Сжатие по compact_every. Вызывается между командами, а не из операции: к этому
+    // моменту операция выполнена и записана, и ошибка сжатия её не отменяет.
+    // Возвращает true, если журнал сжат.
+    bool compact_if_due()
+    {
+        if (file == nullptr || compact_every == 0 || appended < compact_every) return false;
+        compact();
+        return true;
+    }
+
+    // Повторяет журнал в реестр без записи и без истории undo. Множества, упомянутые
+    // в журнале, не должны существовать до повтора. valid - длина целых записей,
+    // base_snapshot - файл снимка из записи base_snapshot, если она есть.
+    static std::size_t replay(const std::string& journal_path, uint64_t *valid = nullptr,
+                              std::string *base_snapshot = nullptr)
+    {
+        std::shared_ptr<MappedFile> mapped = MappedFile::open(journal_path);
+        const std::byte *data = mapped->data();
+        const std::size_t size = mapped->size();
+
+        auto fail = [](const std::string& what) { throw std::runtime_error("повреждённый журнал: " + what); };
+
+        JournalHeader header;
+        if (std::memcmp(data, journal_magic, std::min(size, sizeof(journal_magic))) != 0) fail("неверная сигнатура");
+        if (size < sizeof(header)) fail("файл слишком короткий");
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, journal_magic, sizeof(header.magic)) != 0) fail("неверная сигнатура");
+        if (header.version != journal_version) fail("неизвестная версия");
+        if (header.element_size != sizeof(T))
+        {
+            throw std::runtime_error("журнал содержит множества другого типа");
+        }
+
+        // подряд идущие add одного множества копятся и применяются одной пачкой
+        SetT *batch_set = nullptr;
+        std::vector<T> batch;
+        auto flush_batch = [&]()
+        {
+            if (batch_set != nullptr && !batch.empty()) batch_set->add_all(batch);
+            batch.clear();
+        };
+        auto require = [&](std::string_view name) -> SetT&
+        {
+            SetT *set = SetT::find_set(name);
+            if (set == nullptr) fail("множество " + std::string(name) + " не существует");
+            return *set;
+        };
+
+        std::size_t offset = sizeof(header), count = 0;
+        while (offset + sizeof(JournalRecordHeader) <= size)
+        {
+            JournalRecordHeader record;
+            std::memcpy(&record, data + offset, sizeof(record));
+            std::size_t length = sizeof(record) + record.name_length + std::size_t{record.count} * sizeof(T);
+            if (length > size - offset) break; // недописанная запись
+
+            std::string_view name(reinterpret_cast<const char*>(data + offset + sizeof(record)), record.name_length);
+            std::vector<T> elements(record.count);
+            if (record.count != 0)
+            {
+                std::memcpy(elements.data(), data + offset + sizeof(record) + record.name_length,
+                            elements.size() * sizeof(T));
+            }
+
+            auto op = static_cast<JournalOp>(record.op);
+            if (op == JournalOp::add && elements.size() == 1)
+            {
+                if (batch_set == nullptr || batch_set->get_name() != name)
+                {
+                    flush_batch();
+                    batch_set = &require(name);
+                }
+                batch.push_back(elements[0]);
+            }
+            else
+            {
+                flush_batch();
+                batch_set = nullptr;
+                switch (op)
+                {
+                case JournalOp::create:
+                {
+                    SetT *set = new SetT(std::string(name));
+                    set->add_all(elements);
+                    break;
+                }
+                case JournalOp::drop:
+                    SetT::retire(&require(name));
+                    break;
+                case JournalOp::remove:
+                    if (elements.size() != 1) fail("у записи rem должен быть один элемент");
+                    require(name).try_remove(elements[0]);
+                    break;
+                case JournalOp::base_snapshot:
+                    SetT::load_snapshot((std::filesystem::path(journal_path).parent_path() / name).string());
+                    if (base_snapshot != nullptr) *base_snapshot = name;
+                    break;
+                default:
+                    fail("неизвестная операция");
+                }
+            }
+            offset += length;
+            count++;
+        }
+        flush_batch();
+
+        if (valid != nullptr) *valid = offset;
+        return count;
+    }
+
+private:
+    static JournalOp inverse(JournalOp op)
+    {
+        switch (op)
+        {
+        case JournalOp::create: return JournalOp::drop;
+        case JournalOp::drop: return JournalOp::create;
+        case JournalOp::add: return JournalOp::remove;
+        default: return JournalOp::add;
+        }
+    }
+
+    static std::vector<T> contents(const SetT& set)
+    {
+        std::vector<T> elements(set.size());
+        set.copy_to(elements);
+        return elements;
+    }
+
+    // журнал без проверки записи молча терял бы операции на полном диске
+    static void write_bytes(std::FILE *out, const void *data, std::size_t size, const std::string& file_path)
+    {
+        if (size != 0 && std::fwrite(data, 1, size, out) != size)
+        {
+            throw std::runtime_error("ошибка записи в файл " + file_path);
+        }
+    }
+
+    static JournalHeader make_header()
+    {
+        JournalHeader header{};
+        std::memcpy(header.magic, journal_magic, sizeof(header.magic));
+        header.version = journal_version;
+        header.element_size = sizeof(T);
+        return header;
+    }
+
+    // Файл короче заголовка, совпадающий с началом заголовка, остаётся после обрыва
+    // внутри create_file. Другая сигнатура или версия - не обрыв: такой файл
+    // отвергает replay.
+    static bool torn_header(const std::string& file_path, std::uintmax_t size)
+    {
+        if (size >= sizeof(JournalHeader)) return false;
+        const JournalHeader header = make_header();
+        char bytes[sizeof(JournalHeader)];
+        std::FILE *in = std::fopen(file_path.c_str(), "rb");
+        if (in == nullptr) return false;
+        std::size_t read = std::fread(bytes, 1, static_cast<std::size_t>(size), in);
+        std::fclose(in);
+        return read == size && std::memcmp(bytes, &header, read) == 0;
+    }
+
+    static std::FILE* create_file(const std::string& file_path)
+    {
+        std::FILE *created = std::fopen(file_path.c_str(), "wb");
+        if (created == nullptr) return nullptr;
+        const JournalHeader header = make_header();
+        try
+        {
+            write_bytes(created, &header, sizeof(header), file_path);
+        }
+        catch (...)
+        {
+            std::fclose(created);
+            throw;
+        }
+        return created;
+    }
+
+    static void write_record(std::FILE *out, const std::string& file_path, JournalOp op, std::string_view name,
+                             std::span<const T> elements)
+    {
+        if (name.size() > UINT16_MAX)
+        {
+            throw std::length_error("слишком длинное имя для журнала");
+        }
+        JournalRecordHeader header{static_cast<uint8_t>(op), 0, static_cast<uint16_t>(name.size()),
+                                   static_cast<uint32_t>(elements.size())};
+        write_bytes(out, &header, sizeof(header), file_path);
+        write_bytes(out, name.data(), name.size(), file_path);
+        write_bytes(out, elements.data(), elements.size_bytes(), file_path);
+    }
+
+    // запись в файл; drop хранит содержимое только в памяти - повтору оно не нужно
+    void append(JournalOp op, const Entry& entry)
+    {
+        if (file == nullptr) return;
+        if (op == JournalOp::add || op == JournalOp::remove)
+        {
+            write_record(file, path, op, entry.name, std::span<const T>(&entry.value, 1));
+        }
+        else
+        {
+            write_record(file, path, op, entry.name, op == JournalOp::create ? std::span<const T>(entry.elements)
+                                                                             : std::span<const T>());
+        }
+        appended++;
+    }
+
+    void trim_history()
+    {
+        while (undo_history.size() > history_limit) undo_history.pop_front();
+    }
+
+    // Операция уже выполнена, поэтому сначала попадает в историю: если запись в файл
+    // не удастся, undo всё равно сможет её отменить.
+    void record(Entry entry)
+    {
+        redo_history.clear();
+        undo_history.push_back(std::move(entry));
+        append(undo_history.back().op, undo_history.back());
+        trim_history();
+    }
+
+    // выполняет op над множеством entry.name без записи в журнал
+    void execute(JournalOp op, Entry& entry)
+    {
+        if (op == JournalOp::create)
+        {
+            SetT *set = new SetT(entry.name);
+            set->add_all(entry.elements);
+        }
+        else
+        {
+            SetT *set = SetT::find_set(entry.name);
+            if (set == nullptr)
+            {
+                throw std::logic_error("множество " + entry.name + " не существует");
+            }
+            if (op == JournalOp::drop)
+            {
+                entry.elements = contents(*set);
+                SetT::retire(set);
+            }
+            else if (op == JournalOp::add)
+            {
+                set->try_add(entry.value);
+            }
+            else
+            {
+                set->try_remove(entry.value);
+            }
+        }
+    }
+};
+
+#endif //DISCRETE_MATHEMATICS_SET_JOURNAL_H
@@ -0,0 +1,124 @@
+#ifndef DISCRETE_MATHEMATICS_SET_POOL_H
+#define DISCRETE_MATHEMATICS_SET_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Пул блоков одинакового размера.
+// Память берётся у системы пластинами по BlocksPerSlab блоков, освобождённые блоки
+// возвращаются в односвязный список свободных и переиспользуются, поэтому
+// создание и удаление короткоживущих объектов (результатов слияний) не доходит до malloc.
+// Список свободных защищён мьютексом: множества создаются и удаляются из разных потоков.
+template <std::size_t BlockSize, std::size_t Align, std::size_t BlocksPerSlab = 256>
+class SlabPool
+{
+private:
+    union Block
+    {
+        Block *next;
+        alignas(Align) unsigned char storage[BlockSize];
+    };
+
+    struct SlabDeleter
+    {
+        void operator()(Block *slab) const
+        {
+            ::operator delete(slab, std::align_val_t{alignof(Block)});
+        }
+    };
+
+    std::vector<std::unique_ptr<Block, SlabDeleter>> slabs;
+    Block *free_list = nullptr;
+    mutable std::mutex mutex;
+
+    void grow()
+    {
+        auto *slab = static_cast<Block*>(
+            ::operator new(sizeof(Block) * BlocksPerSlab, std::align_val_t{alignof(Block)}));
+        slabs.emplace_back(slab);
+        for (std::size_t i = BlocksPerSlab; i-- > 0;)
+        {
+            slab[i].next = free_list;
+            free_list = &slab[i];
+        }
+    }
+
+public:
+    SlabPool() = default;
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    void *allocate()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (free_list == nullptr)
+        {
+            grow();
+        }
+        Block *block = free_list;
+        free_list = block->next;
+        return block;
+    }
+
+    void deallocate(void *ptr)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Block *block = static_cast<Block*>(ptr);
+        block->next = free_list;
+        free_list = block;
+    }
+
+    std::size_t reserved_bytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return slabs.size() * BlocksPerSlab * sizeof(Block);
+    }
+};
+
+// Аллокатор для std::allocate_shared: одиночные объекты U (вместе с блоком счётчика
+// ссылок) берутся из общего на тип пула, массивы - у системы.
+template <typename U>
+class PoolAllocator
+{
+private:
+    static auto& pool()
+    {
+        static SlabPool<sizeof(U), alignof(U)> instance;
+        return instance;
+    }
+
+public:
+    using value_type = U;
+
+    PoolAllocator() = default;
+
+    template <typename V>
+    PoolAllocator(const PoolAllocator<V>&) {}
+
+    U *allocate(std::size_t n)
+    {
+        if (n == 1) return static_cast<U*>(pool().allocate());
+        return static_cast<U*>(::operator new(n * sizeof(U), std::align_val_t{alignof(U)}));
+    }
+
+    void deallocate(U *ptr, std::size_t n)
+    {
+        if (n == 1)
+        {
+            pool().deallocate(ptr);
+            return;
+        }
+        ::operator delete(ptr, std::align_val_t{alignof(U)});
+    }
+
+    template <typename V>
+    bool operator==(const PoolAllocator<V>&) const
+    {
+        return true;
+    }
+};
+
+#endif //DISCRETE_MATHEMATICS_SET_POOL_H
@@ -0,0 +1,210 @@
+#ifndef DISCRETE_MATHEMATICS_SET_RECLAIM_H
+#define DISCRETE_MATHEMATICS_SET_RECLAIM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+// Отложенное освобождение по эпохам (epoch-based reclamation).
+// Читатель на время работы с найденными в реестре объектами держит Guard: поток
+// объявляет в своём слоте эпоху, в которую он начал чтение. Удаляемый объект сначала
+// исключается из реестра, затем передаётся в retire и помечается текущей эпохой;
+// освобождается он только тогда, когда все объявленные эпохи стали больше его метки,
+// то есть ни один читатель, который мог его увидеть, уже не работает.
+// Чтение не берёт блокировок: вход и выход из Guard - две атомарные записи.
+// Слотов max_readers; потоки сверх них делят один общий слот под мьютексом: его
+// эпоха - эпоха первого из одновременно читающих, что только задерживает освобождение.
+// Tag отделяет экземпляры (по одному на тип множества): у каждого свой слот в потоке.
+template <typename Tag>
+class EpochReclaimer
+{
+public:
+    static constexpr std::size_t max_readers = 128;
+
+private:
+    static constexpr uint64_t idle = std::numeric_limits<uint64_t>::max();
+
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> epoch{idle};
+        std::atomic<bool> used{false};
+    };
+
+    struct Retired
+    {
+        void *ptr;
+        void (*destroy)(void*);
+        uint64_t epoch;
+    };
+
+    // слот потока и глубина вложенных Guard
+    struct LocalState
+    {
+        Slot *slot = nullptr;
+        bool shared = false; // слоты кончились, поток читает через общий слот
+        std::size_t depth = 0;
+
+        ~LocalState()
+        {
+            if (slot == nullptr || shared) return;
+            slot->epoch.store(idle, std::memory_order_release);
+            slot->used.store(false, std::memory_order_release);
+        }
+    };
+
+    std::array<Slot, max_readers> slots;
+    Slot shared_slot;
+    std::mutex shared_mutex;
+    std::size_t shared_readers = 0; // под shared_mutex
+    std::atomic<uint64_t> global_epoch{1};
+    std::mutex retired_mutex;
+    std::vector<Retired> retired;
+
+    // экземпляр на Tag один и живёт до конца программы, поэтому слот потока кэшируется
+    LocalState& local()
+    {
+        thread_local LocalState state;
+        if (state.slot == nullptr)
+        {
+            state.slot = acquire_slot();
+            state.shared = state.slot == nullptr;
+            if (state.shared) state.slot = &shared_slot;
+        }
+        return state;
+    }
+
+    Slot *acquire_slot()
+    {
+        for (Slot& slot : slots)
+        {
+            bool expected = false;
+            if (!slot.used.load(std::memory_order_relaxed) &&
+                slot.used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    uint64_t min_active_epoch() const
+    {
+        // парный барьер писателя: исключение объекта из структуры упорядочено до чтения слотов
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t result = idle;
+        for (const Slot& slot : slots)
+        {
+            uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+            if (epoch < result) result = epoch;
+        }
+        uint64_t epoch = shared_slot.epoch.load(std::memory_order_seq_cst);
+        return epoch < result ? epoch : result;
+    }
+
+    void pin()
+    {
+        LocalState& state = local();
+        if (state.depth++ != 0) return;
+        if (state.shared)
+        {
+            // общий слот сохраняет эпоху первого читателя, пока читает хоть один
+            std::lock_guard<std::mutex> lock(shared_mutex);
+            if (shared_readers++ == 0)
+            {
+                shared_slot.epoch.store(global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+            return;
+        }
+        state.slot->epoch.store(global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        // Барьер: объявление эпохи должно стать видно раньше, чем читатель загрузит
+        // указатели на защищаемые объекты (acquire-загрузки сами по себе не упорядочены
+        // после более ранней записи).
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void unpin()
+    {
+        LocalState& state = local();
+        if (--state.depth != 0) return;
+        if (state.shared)
+        {
+            std::lock_guard<std::mutex> lock(shared_mutex);
+            if (--shared_readers == 0) shared_slot.epoch.store(idle, std::memory_order_release);
+            return;
+        }
+        state.slot->epoch.store(idle, std::memory_order_release);
+    }
+
+public:
+    class Guard
+    {
+    private:
+        EpochReclaimer *owner;
+
+    public:
+        explicit Guard(EpochReclaimer& owner) : owner(&owner)
+        {
+            owner.pin();
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard()
+        {
+            owner->unpin();
+        }
+    };
+
+public:
+    EpochReclaimer() = default;
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    ~EpochReclaimer()
+    {
+        for (const Retired& item : retired) item.destroy(item.ptr);
+    }
+
+    // ptr уже недоступен новым читателям; destroy(ptr) вызовется, когда уйдут старые
+    void retire(void *ptr, void (*destroy)(void*))
+    {
+        uint64_t epoch = global_epoch.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::lock_guard<std::mutex> lock(retired_mutex);
+            retired.push_back({ptr, destroy, epoch});
+        }
+        collect();
+    }
+
+    // освобождает всё, что больше не может быть видно читателям
+    void collect()
+    {
+        std::vector<Retired> ready;
+        {
+            std::lock_guard<std::mutex> lock(retired_mutex);
+            uint64_t safe = min_active_epoch();
+            auto keep = retired.begin();
+            for (const Retired& item : retired)
+            {
+                if (item.epoch < safe) ready.push_back(item);
+                else *keep++ = item;
+            }
+            retired.erase(keep, retired.end());
+        }
+        for (const Retired& item : ready) item.destroy(item.ptr);
+    }
+
+    std::size_t pending()
+    {
+        std::lock_guard<std::mutex> lock(retired_mutex);
+        return retired.size();
+    }
+};
+
+#endif //DISCRETE_MATHEMATICS_SET_RECLAIM_H
@@ -0,0 +1,366 @@
+#ifndef DISCRETE_MATHEMATICS_SET_REGISTRY_H
+#define DISCRETE_MATHEMATICS_SET_REGISTRY_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "set_reclaim.h"
+
+// Реестр именованных множеств, безопасный для одновременной работы нескольких потоков.
+// Однобуквенные имена 'A'..'Z' лежат в массиве атомарных указателей, свободные
+// буквы - в атомарной битовой маске, поэтому поиск, создание и удаление таких
+// множеств обходятся без блокировок. Остальные имена разложены по шардам: у шарда
+// хеш-таблица с цепочками из атомарных указателей. Писатель под мьютексом своего
+// шарда вставляет узел в голову цепочки или вырезает его из неё - O(1), без
+// копирования таблицы. Читатель идёт по цепочке без блокировок, объявив эпоху;
+// вырезанные узлы и таблицы, заменённые при росте, освобождаются, когда уйдут
+// читатели, которые могли их видеть (EpochReclaimer из set_reclaim.h).
+// Реестр не владеет множествами: удаляемое множество, которое могут читать другие
+// потоки, освобождается отложенно тем же механизмом.
+template <typename SetT>
+class SetRegistry
+{
+private:
+    using Reclaimer = EpochReclaimer<SetRegistry>;
+
+    struct NameHash
+    {
+        std::size_t operator()(std::string_view name) const
+        {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+    // узел неизменяем после публикации, кроме ссылки next
+    struct Node
+    {
+        std::string name;
+        std::size_t hash;
+        SetT *set;
+        uint64_t seq; // номер создания, задаёт порядок обхода
+        std::atomic<Node*> next{nullptr};
+    };
+
+    // Корзины шарда. При росте узлы копируются в новую таблицу, а старая целиком
+    // (с узлами, которые ещё могут читать) уходит в отложенное освобождение.
+    struct Table
+    {
+        std::size_t bucket_count;
+        std::unique_ptr<std::atomic<Node*>[]> buckets;
+
+        explicit Table(std::size_t bucket_count)
+            : bucket_count(bucket_count), buckets(new std::atomic<Node*>[bucket_count])
+        {
+            for (std::size_t i = 0; i < bucket_count; i++) buckets[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        Table(const Table&) = delete;
+        Table& operator=(const Table&) = delete;
+
+        ~Table()
+        {
+            for (std::size_t i = 0; i < bucket_count; i++)
+            {
+                Node *node = buckets[i].load(std::memory_order_relaxed);
+                while (node != nullptr)
+                {
+                    Node *next = node->next.load(std::memory_order_relaxed);
+                    delete node;
+                    node = next;
+                }
+            }
+        }
+
+        // младшие биты хеша выбирают шард, корзину выбирают следующие
+        std::atomic<Node*>& bucket(std::size_t hash)
+        {
+            return buckets[(hash / shard_count) & (bucket_count - 1)];
+        }
+    };
+
+    struct Shard
+    {
+        std::mutex writer;
+        std::atomic<Table*> table{new Table(initial_buckets)};
+        std::size_t size = 0; // под writer
+    };
+
+    static constexpr std::size_t shard_count = 16;
+    static constexpr std::size_t initial_buckets = 8;
+    static constexpr uint32_t all_letters = (uint32_t{1} << 26) - 1;
+
+    std::array<std::atomic<SetT*>, 26> letters{};
+    std::array<std::atomic<uint64_t>, 26> letter_seq{};
+    std::atomic<uint32_t> free_letters{all_letters};
+    std::array<Shard, shard_count> shards;
+    std::atomic<uint64_t> next_seq{0};
+    std::atomic<std::size_t> count{0};
+    std::atomic<std::size_t> generated{0};
+
+    static Reclaimer& reclaimer()
+    {
+        static Reclaimer instance;
+        return instance;
+    }
+
+    static int letter_index(std::string_view name)
+    {
+        if (name.size() == 1 && name[0] >= 'A' && name[0] <= 'Z')
+        {
+            return name[0] - 'A';
+        }
+        return -1;
+    }
+
+    static Node *find_in(Table& table, std::string_view name, std::size_t hash)
+    {
+        for (Node *node = table.bucket(hash).load(std::memory_order_acquire); node != nullptr;
+             node = node->next.load(std::memory_order_acquire))
+        {
+            if (node->hash == hash && node->name == name) return node;
+        }
+        return nullptr;
+    }
+
+    void publish_letter(int letter, SetT *set)
+    {
+        letter_seq[letter].store(next_seq.fetch_add(1), std::memory_order_relaxed);
+        letters[letter].store(set, std::memory_order_release);
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Удваивает число корзин шарда (вызывается под writer). Копирование узлов
+    // окупается удвоением: в среднем O(1) на вставку.
+    static Table *grow(Shard& shard, Table *old)
+    {
+        Table *next = new Table(old->bucket_count * 2);
+        for (std::size_t i = 0; i < old->bucket_count; i++)
+        {
+            for (Node *node = old->buckets[i].load(std::memory_order_relaxed); node != nullptr;
+                 node = node->next.load(std::memory_order_relaxed))
+            {
+                std::atomic<Node*>& head = next->bucket(node->hash);
+                Node *copy = new Node{node->name, node->hash, node->set, node->seq};
+                copy->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                head.store(copy, std::memory_order_relaxed);
+            }
+        }
+        shard.table.store(next, std::memory_order_release);
+        reclaimer().retire(old, [](void *ptr) { delete static_cast<Table*>(ptr); });
+        return next;
+    }
+
+    // вставка в шард; false, если имя занято
+    template <typename Prepare>
+    bool insert_into_shard(const std::string& name, SetT *set, Prepare&& prepare)
+    {
+        std::size_t hash = NameHash{}(name);
+        Shard& shard = shards[hash % shard_count];
+        std::lock_guard<std::mutex> lock(shard.writer);
+        Table *table = shard.table.load(std::memory_order_relaxed);
+        if (find_in(*table, name, hash) != nullptr)
+        {
+            return false;
+        }
+        if (shard.size >= table->bucket_count) table = grow(shard, table);
+
+        std::unique_ptr<Node> node(new Node{name, hash, set, next_seq.fetch_add(1)});
+        std::atomic<Node*>& head = table->bucket(hash);
+        node->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        prepare(name);
+        head.store(node.release(), std::memory_order_release);
+        shard.size++;
+        count.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+public:
+    SetRegistry() = default;
+    SetRegistry(const SetRegistry&) = delete;
+    SetRegistry& operator=(const SetRegistry&) = delete;
+
+    ~SetRegistry()
+    {
+        for (Shard& shard : shards) delete shard.table.load(std::memory_order_relaxed);
+    }
+
+public:
+    // имя начинается с буквы и состоит из латинских букв, цифр и '_'
+    static bool is_valid_name(std::string_view name)
+    {
+        if (name.empty() || !std::isalpha(static_cast<unsigned char>(name[0])))
+        {
+            return false;
+        }
+        for (char c : name)
+        {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+        }
+        return true;
+    }
+
+public:
+    SetT *find(std::string_view name) const
+    {
+        int letter = letter_index(name);
+        if (letter >= 0)
+        {
+            return letters[letter].load(std::memory_order_acquire);
+        }
+
+        std::size_t hash = NameHash{}(name);
+        typename Reclaimer::Guard guard(reclaimer());
+        Table *table = shards[hash % shard_count].table.load(std::memory_order_acquire);
+        Node *node = find_in(*table, name, hash);
+        return node == nullptr ? nullptr : node->set;
+    }
+
+    void insert(const std::string& name, SetT *set)
+    {
+        int letter = letter_index(name);
+        if (letter >= 0)
+        {
+            uint32_t bit = uint32_t{1} << letter;
+            if ((free_letters.fetch_and(~bit) & bit) == 0)
+            {
+                throw std::logic_error("множество уже существует");
+            }
+            publish_letter(letter, set);
+            return;
+        }
+
+        if (!insert_into_shard(name, set, [](const std::string&) {}))
+        {
+            throw std::logic_error("множество уже существует");
+        }
+    }
+
+    // Регистрирует set под первым свободным именем (как free_name, но выбор и
+    // вставка атомарны). prepare(name) вызывается до того, как множество станет видно
+    // другим потокам.
+    template <typename Prepare>
+    void insert_unnamed(SetT *set, Prepare prepare)
+    {
+        uint32_t free = free_letters.load(std::memory_order_relaxed);
+        while (free != 0)
+        {
+            int letter = std::countr_zero(free);
+            if (free_letters.compare_exchange_weak(free, free & ~(uint32_t{1} << letter)))
+            {
+                prepare(std::string(1, static_cast<char>('A' + letter)));
+                publish_letter(letter, set);
+                return;
+            }
+        }
+
+        while (!insert_into_shard("S" + std::to_string(generated.fetch_add(1) + 1), set, prepare))
+        {
+        }
+    }
+
+    // удаляет имя, только если под ним зарегистрировано именно set
+    void erase(const std::string& name, const SetT *set)
+    {
+        int letter = letter_index(name);
+        if (letter >= 0)
+        {
+            SetT *expected = const_cast<SetT*>(set);
+            if (letters[letter].compare_exchange_strong(expected, nullptr))
+            {
+                free_letters.fetch_or(uint32_t{1} << letter);
+                count.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return;
+        }
+
+        std::size_t hash = NameHash{}(name);
+        Shard& shard = shards[hash % shard_count];
+        std::lock_guard<std::mutex> lock(shard.writer);
+        Table *table = shard.table.load(std::memory_order_relaxed);
+        std::atomic<Node*> *link = &table->bucket(hash);
+        for (Node *node = link->load(std::memory_order_relaxed); node != nullptr;
+             link = &node->next, node = link->load(std::memory_order_relaxed))
+        {
+            if (node->hash != hash || node->name != name) continue;
+            if (node->set != set) return;
+
+            // читатель, стоящий на node, дойдёт по его next до конца цепочки
+            link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+            shard.size--;
+            count.fetch_sub(1, std::memory_order_relaxed);
+            reclaimer().retire(node, [](void *ptr) { delete static_cast<Node*>(ptr); });
+            return;
+        }
+    }
+
+    // Первая свободная буква, а когда буквы закончились - S1, S2, ...
+    // При одновременной записи имя может успеть занять другой поток; для
+    // регистрации без гонки есть insert_unnamed.
+    std::string free_name()
+    {
+        uint32_t free = free_letters.load(std::memory_order_relaxed);
+        if (free != 0)
+        {
+            return std::string(1, static_cast<char>('A' + std::countr_zero(free)));
+        }
+
+        std::string name;
+        do
+        {
+            name = "S" + std::to_string(generated.fetch_add(1) + 1);
+        } while (find(name) != nullptr);
+        return name;
+    }
+
+    std::size_t size() const
+    {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    // Обход в порядке создания.
+    // Множества, созданные или удалённые во время обхода, могут как попасть в него, так и нет.
+    template <typename F>
+    void for_each(F f) const
+    {
+        std::vector<std::pair<uint64_t, SetT*>> sets;
+        for (int letter = 0; letter < 26; letter++)
+        {
+            SetT *set = letters[letter].load(std::memory_order_acquire);
+            if (set != nullptr) sets.emplace_back(letter_seq[letter].load(std::memory_order_relaxed), set);
+        }
+        {
+            typename Reclaimer::Guard guard(reclaimer());
+            for (const Shard& shard : shards)
+            {
+                Table *table = shard.table.load(std::memory_order_acquire);
+                for (std::size_t i = 0; i < table->bucket_count; i++)
+                {
+                    for (Node *node = table->buckets[i].load(std::memory_order_acquire); node != nullptr;
+                         node = node->next.load(std::memory_order_acquire))
+                    {
+                        sets.emplace_back(node->seq, node->set);
+                    }
+                }
+            }
+        }
+
+        std::sort(sets.begin(), sets.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (const auto& [seq, set] : sets) f(set);
+    }
+};
+
+#endif //DISCRETE_MATHEMATICS_SET_REGISTRY_H
@@ -0,0 +1,1314 @@
+#ifndef DISCRETE_MATHEMATICS_SET_STORAGE_H
+#define DISCRETE_MATHEMATICS_SET_STORAGE_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "set_pool.h"
+#include "simd_kernels.h"
+
+// Политики хранения элементов для BasicSet.
+// Каждая политика даёт одинаковый набор операций над одним множеством
+// (contains / insert / erase / size / for_each), построитель из возрастающей
+// последовательности (clear / reserve / append_sorted), статические операции
+// над парой множеств (unite / intersect / subtract / sym_difference / is_subset / equal
+// и мощность пересечения intersect_count) и над любым числом множеств
+// (unite_all / intersect_all), поэтому алгоритмы слияния выбираются на этапе компиляции.
+
+// Плотная битовая карта: бит с номером i установлен, если элемент i есть в множестве.
+// Для однобайтовых типов универсум фиксирован (256 бит = 4 слова по 64 бита) и карта
+// лежит прямо в объекте. Для остальных целых типов карта растёт до наибольшего
+// добавленного элемента и делится на куски по chunk_words слов; куски разделяются
+// между множествами по счётчику ссылок и копируются при записи: результат слияния,
+// кусок которого совпал с куском операнда, ссылается на него, а add/rem копируют
+// только тот кусок, в который пишут. Пустой кусок не хранится вовсе.
+// Карта может смотреть в чужую память (снимок, отображённый в память, см. snapshot.h);
+// первая запись копирует её в собственную.
+template <typename T>
+class BitmapStorage
+{
+    static_assert(std::is_integral_v<T>, "битовая карта поддерживает только целые элементы");
+
+public:
+    static constexpr std::size_t word_bits = 64;
+    static constexpr bool fixed_universe = sizeof(T) == 1;
+    static constexpr std::size_t fixed_words = 256 / word_bits;
+    static constexpr std::size_t chunk_words = fixed_universe ? fixed_words : 64;
+
+private:
+    using Chunk = std::array<uint64_t, chunk_words>;
+    using ChunkPtr = std::shared_ptr<Chunk>;
+    using Words = std::conditional_t<fixed_universe, Chunk, std::vector<ChunkPtr>>;
+    Words words{};
+
+    const uint64_t *view = nullptr;
+    std::size_t view_words = 0;
+    std::shared_ptr<const void> view_owner;
+
+    static const uint64_t *zero_chunk()
+    {
+        static const Chunk zero{};
+        return zero.data();
+    }
+
+    static bool in_universe(T value)
+    {
+        if constexpr (!fixed_universe && std::is_signed_v<T>)
+        {
+            return value >= 0;
+        }
+        return true;
+    }
+
+    static std::size_t index_of(T value)
+    {
+        if constexpr (fixed_universe)
+        {
+            return static_cast<unsigned char>(value);
+        }
+        return static_cast<std::size_t>(value);
+    }
+
+    static bool is_zero(const uint64_t *chunk)
+    {
+        return std::all_of(chunk, chunk + chunk_words, [](uint64_t x) { return x == 0; });
+    }
+
+    std::size_t chunk_count() const
+    {
+        if (view != nullptr) return view_words / chunk_words;
+        if constexpr (fixed_universe) return 1;
+        else return words.size();
+    }
+
+    // слова куска c; отсутствующий кусок читается как нулевой
+    const uint64_t *chunk(std::size_t c) const
+    {
+        if (view != nullptr) return c < chunk_count() ? view + c * chunk_words : zero_chunk();
+        if constexpr (fixed_universe)
+        {
+            return words.data();
+        }
+        else
+        {
+            return c < words.size() && words[c] ? words[c]->data() : zero_chunk();
+        }
+    }
+
+    // делает карту собственной и пустой
+    void reset()
+    {
+        view = nullptr;
+        view_words = 0;
+        view_owner.reset();
+        if constexpr (fixed_universe)
+        {
+            words.fill(0);
+        }
+        else
+        {
+            words.clear();
+        }
+    }
+
+    // копирует отображённую карту в собственную память перед первой записью
+    void detach_view()
+    {
+        if (view == nullptr) return;
+        const uint64_t *source = view;
+        std::size_t count = chunk_count();
+        view = nullptr;
+        view_words = 0;
+        if constexpr (fixed_universe)
+        {
+            std::copy(source, source + chunk_words, words.begin());
+        }
+        else
+        {
+            words.assign(count, nullptr);
+            for (std::size_t c = 0; c < count; c++)
+            {
+                const uint64_t *from = source + c * chunk_words;
+                if (!is_zero(from)) words[c] = copy_chunk(from);
+            }
+        }
+        view_owner.reset();
+    }
+
+    // куски с их счётчиками ссылок берутся из пула (set_pool.h);
+    // кусок без обнуления - для тех, кто сразу перезапишет все его слова
+    static ChunkPtr make_chunk()
+    {
+        return std::allocate_shared<Chunk>(PoolAllocator<Chunk>{});
+    }
+
+    static ChunkPtr make_chunk_for_overwrite()
+    {
+        return std::allocate_shared_for_overwrite<Chunk>(PoolAllocator<Chunk>{});
+    }
+
+    static ChunkPtr copy_chunk(const uint64_t *from)
+    {
+        auto chunk = make_chunk_for_overwrite();
+        std::copy(from, from + chunk_words, chunk->begin());
+        return chunk;
+    }
+
+    // кусок c для записи: создаётся, если его нет, и копируется, если он общий
+    uint64_t *mutable_chunk(std::size_t c)
+    {
+        detach_view();
+        if constexpr (fixed_universe)
+        {
+            return words.data();
+        }
+        else
+        {
+            if (c >= words.size()) words.resize(c + 1);
+            ChunkPtr& chunk = words[c];
+            if (!chunk) chunk = make_chunk();
+            else if (chunk.use_count() > 1) chunk = copy_chunk(chunk->data());
+            return chunk->data();
+        }
+    }
+
+    // ссылка на кусок c карты source без копирования слов (для отображённой карты - копия)
+    static ChunkPtr share_chunk(const BitmapStorage& source, std::size_t c)
+    {
+        if constexpr (!fixed_universe)
+        {
+            if (source.view == nullptr) return c < source.words.size() ? source.words[c] : nullptr;
+        }
+        const uint64_t *from = source.chunk(c);
+        return from == zero_chunk() || is_zero(from) ? nullptr : copy_chunk(from);
+    }
+
+    // Кусок c результата посчитан в result из кусков a и b: если он пуст или совпал
+    // с куском операнда, result не нужен и результат ссылается на кусок операнда.
+    void store_chunk(std::size_t c, ChunkPtr result, const BitmapStorage& a, const BitmapStorage& b)
+    {
+        if (is_zero(result->data())) result = nullptr;
+        else if (simd::bitmap_equal(result->data(), a.chunk(c), chunk_words)) result = share_chunk(a, c);
+        else if (simd::bitmap_equal(result->data(), b.chunk(c), chunk_words)) result = share_chunk(b, c);
+        words[c] = std::move(result);
+    }
+
+    // убирает пустые куски в конце карты
+    void trim()
+    {
+        if constexpr (!fixed_universe)
+        {
+            while (!words.empty() && !words.back()) words.pop_back();
+        }
+    }
+
+    // Результат по кускам: kernel считает слова куска, а shortcut по тому, какой из
+    // кусков нулевой и не один ли это кусок, может сразу назвать ответ
+    // (0 - пусто, 1 - кусок a, 2 - кусок b, -1 - считать).
+    template <typename Kernel, typename Shortcut>
+    static void combine(const BitmapStorage& a, const BitmapStorage& b, BitmapStorage& out, std::size_t count,
+                        Kernel kernel, Shortcut shortcut)
+    {
+        out.reset();
+        if constexpr (!fixed_universe)
+        {
+            out.words.resize(count);
+        }
+        for (std::size_t c = 0; c < count; c++)
+        {
+            const uint64_t *ca = a.chunk(c), *cb = b.chunk(c);
+            if constexpr (fixed_universe)
+            {
+                kernel(ca, cb, out.words.data(), chunk_words);
+            }
+            else
+            {
+                int known = shortcut(ca == zero_chunk(), cb == zero_chunk(), ca == cb);
+                if (known == 0) continue;
+                if (known == 1)
+                {
+                    out.words[c] = share_chunk(a, c);
+                    continue;
+                }
+                if (known == 2)
+                {
+                    out.words[c] = share_chunk(b, c);
+                    continue;
+                }
+
+                ChunkPtr result = make_chunk_for_overwrite();
+                kernel(ca, cb, result->data(), chunk_words);
+                out.store_chunk(c, std::move(result), a, b);
+            }
+        }
+        out.trim();
+    }
+
+    // n-арная свёртка по кускам: kernel применяется ко всем ненулевым кускам операндов
+    // подряд; кусок, который есть только у одного операнда (или общий у всех), берётся
+    // по ссылке. Для пересечения нулевой кусок любого операнда обнуляет результат.
+    template <typename Kernel>
+    static void reduce_all(std::span<const BitmapStorage* const> sets, BitmapStorage& out, std::size_t count,
+                           Kernel kernel, bool intersection)
+    {
+        out.reset();
+        if constexpr (fixed_universe)
+        {
+            std::copy(sets[0]->chunk(0), sets[0]->chunk(0) + chunk_words, out.words.begin());
+            for (std::size_t k = 1; k < sets.size(); k++)
+            {
+                kernel(out.words.data(), sets[k]->chunk(0), out.words.data(), chunk_words);
+            }
+        }
+        else
+        {
+            out.words.resize(count);
+            std::vector<const uint64_t*> parts;
+            for (std::size_t c = 0; c < count; c++)
+            {
+                parts.clear();
+                std::size_t owner = 0;
+                bool zero = false;
+                for (std::size_t k = 0; k < sets.size(); k++)
+                {
+                    const uint64_t *part = sets[k]->chunk(c);
+                    if (part == zero_chunk())
+                    {
+                        zero = true;
+                        if (intersection) break;
+                        continue;
+                    }
+                    if (!parts.empty() && part == parts.front()) continue;
+                    if (parts.empty()) owner = k;
+                    parts.push_back(part);
+                }
+                if ((intersection && zero) || parts.empty()) continue;
+                if (parts.size() == 1)
+                {
+                    out.words[c] = share_chunk(*sets[owner], c);
+                    continue;
+                }
+
+                ChunkPtr result = make_chunk_for_overwrite();
+                kernel(parts[0], parts[1], result->data(), chunk_words);
+                for (std::size_t k = 2; k < parts.size(); k++) kernel(result->data(), parts[k], result->data(), chunk_words);
+                if (!is_zero(result->data())) out.words[c] = std::move(result);
+            }
+            out.trim();
+        }
+    }
+
+public:
+    // пословный доступ для вычислителя выражений и других пословных алгоритмов
+    std::size_t word_count() const
+    {
+        return chunk_count() * chunk_words;
+    }
+
+    uint64_t word(std::size_t i) const
+    {
+        return i < word_count() ? chunk(i / chunk_words)[i % chunk_words] : 0;
+    }
+
+    // Копирует слова [0, n) карты в out кусками (memcpy), хвост out обнуляет.
+    // Возвращает false, если за пределами n слов есть установленные биты.
+    bool copy_words(uint64_t *out, std::size_t n) const
+    {
+        std::size_t filled = 0;
+        for (std::size_t c = 0; c < chunk_count(); c++)
+        {
+            const uint64_t *from = chunk(c);
+            std::size_t first = c * chunk_words;
+            std::size_t inside = first < n ? std::min(chunk_words, n - first) : 0;
+            if (inside != 0)
+            {
+                std::copy(from, from + inside, out + first);
+                filled = first + inside;
+            }
+            if (inside < chunk_words && from != zero_chunk() &&
+                !std::all_of(from + inside, from + chunk_words, [](uint64_t x) { return x == 0; }))
+            {
+                return false;
+            }
+        }
+        std::fill(out + filled, out + n, 0);
+        return true;
+    }
+
+    // заполняет карту из count слов значениями make(i)
+    template <typename F>
+    void assign_words(std::size_t count, F make)
+    {
+        reset();
+        if constexpr (fixed_universe)
+        {
+            for (std::size_t i = 0; i < chunk_words && i < count; i++) words[i] = make(i);
+        }
+        else
+        {
+            words.resize((count + chunk_words - 1) / chunk_words);
+            Chunk result;
+            for (std::size_t c = 0; c < words.size(); c++)
+            {
+                for (std::size_t i = 0; i < chunk_words; i++)
+                {
+                    std::size_t index = c * chunk_words + i;
+                    result[i] = index < count ? make(index) : 0;
+                }
+                if (!is_zero(result.data())) words[c] = copy_chunk(result.data());
+            }
+            trim();
+        }
+    }
+
+    // карта поверх count слов по адресу data; owner держит память живой
+    static BitmapStorage view_of(const uint64_t *data, std::size_t count, std::shared_ptr<const void> owner)
+    {
+        if (fixed_universe && count != fixed_words)
+        {
+            throw std::invalid_argument("размер битовой карты не совпадает с универсумом");
+        }
+        BitmapStorage storage;
+        if (count % chunk_words != 0)
+        {
+            // неполный последний кусок нельзя читать на месте
+            storage.assign_words(count, [data](std::size_t i) { return data[i]; });
+            return storage;
+        }
+        storage.view = data;
+        storage.view_words = count;
+        storage.view_owner = std::move(owner);
+        return storage;
+    }
+
+    bool is_view() const
+    {
+        return view != nullptr;
+    }
+
+    bool contains(T value) const
+    {
+        if (!in_universe(value)) return false;
+        std::size_t i = index_of(value);
+        return (word(i / word_bits) >> (i % word_bits)) & 1;
+    }
+
+    bool insert(T value)
+    {
+        if (!in_universe(value))
+        {
+            throw std::out_of_range("элемент вне универсума битовой карты");
+        }
+        if (contains(value)) return false;
+        std::size_t i = index_of(value);
+        mutable_chunk(i / word_bits / chunk_words)[i / word_bits % chunk_words] |= uint64_t{1} << (i % word_bits);
+        return true;
+    }
+
+    bool erase(T value)
+    {
+        if (!contains(value)) return false;
+        std::size_t i = index_of(value);
+        mutable_chunk(i / word_bits / chunk_words)[i / word_bits % chunk_words] &= ~(uint64_t{1} << (i % word_bits));
+        return true;
+    }
+
+    void clear()
+    {
+        reset();
+    }
+
+    void reserve(std::size_t)
+    {
+    }
+
+    // value больше всех уже добавленных: установка бита без проверки повтора
+    void append_sorted(T value)
+    {
+        if (!in_universe(value))
+        {
+            throw std::out_of_range("элемент вне универсума битовой карты");
+        }
+        std::size_t i = index_of(value);
+        mutable_chunk(i / word_bits / chunk_words)[i / word_bits % chunk_words] |= uint64_t{1} << (i % word_bits);
+    }
+
+    bool empty() const
+    {
+        for (std::size_t c = 0; c < chunk_count(); c++)
+        {
+            if (!is_zero(chunk(c))) return false;
+        }
+        return true;
+    }
+
+    std::size_t size() const
+    {
+        std::size_t count = 0;
+        for (std::size_t c = 0; c < chunk_count(); c++)
+        {
+            const uint64_t *w = chunk(c);
+            if (w == zero_chunk()) continue;
+            for (std::size_t i = 0; i < chunk_words; i++) count += std::popcount(w[i]);
+        }
+        return count;
+    }
+
+    // обход по возрастанию индекса: младший бит слова -> старший
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (std::size_t c = 0; c < chunk_count(); c++)
+        {
+            const uint64_t *w = chunk(c);
+            if (w == zero_chunk()) continue;
+            for (std::size_t i = 0; i < chunk_words; i++)
+            {
+                uint64_t word_bits_left = w[i];
+                while (word_bits_left != 0)
+                {
+                    f(static_cast<T>((c * chunk_words + i) * word_bits + std::countr_zero(word_bits_left)));
+                    word_bits_left &= word_bits_left - 1;
+                }
+            }
+        }
+    }
+
+public:
+    // Куски обрабатываются векторными ядрами (simd_kernels.h). Общий кусок обоих
+    // операндов и кусок, которого нет у одного из них, не пересчитываются.
+    static void unite(const BitmapStorage& a, const BitmapStorage& b, BitmapStorage& out)
+    {
+        combine(a, b, out, std::max(a.chunk_count(), b.chunk_count()), simd::bitmap_or,
+                [](bool zero_a, bool zero_b, bool same)
+                {
+                    return zero_a && zero_b ? 0 : zero_b || same ? 1 : zero_a ? 2 : -1;
+                });
+    }
+
+    static void intersect(const BitmapStorage& a, const BitmapStorage& b, BitmapStorage& out)
+    {
+        combine(a, b, out, std::min(a.chunk_count(), b.chunk_count()), simd::bitmap_and,
+                [](bool zero_a, bool zero_b, bool same) { return zero_a || zero_b ? 0 : same ? 1 : -1; });
+    }
+
+    static void subtract(const BitmapStorage& a, const BitmapStorage& b, BitmapStorage& out)
+    {
+        combine(a, b, out, a.chunk_count(), simd::bitmap_andnot,
+                [](bool zero_a, bool zero_b, bool same) { return zero_a || same ? 0 : zero_b ? 1 : -1; });
+    }
+
+    static void sym_difference(const BitmapStorage& a, const BitmapStorage& b, BitmapStorage& out)
+    {
+        combine(a, b, out, std::max(a.chunk_count(), b.chunk_count()), simd::bitmap_xor,
+                [](bool zero_a, bool zero_b, bool same)
+                {
+                    return (zero_a && zero_b) || same ? 0 : zero_b ? 1 : zero_a ? 2 : -1;
+                });
+    }
+
+    // Дополнение до диапазона [first, last] пословно: ~слово под маской диапазона.
+    // У char отрицательные значения лежат в старших индексах, поэтому диапазон
+    // через ноль занимает два отрезка карты.
+    static void complement(const BitmapStorage& a, T first, T last, BitmapStorage& out)
+    {
+        if (!in_universe(first))
+        {
+            throw std::out_of_range("элемент вне универсума битовой карты");
+        }
+        std::size_t lo = index_of(first), hi = index_of(last);
+        auto mask = [](std::size_t w, std::size_t from, std::size_t to) -> uint64_t
+        {
+            std::size_t begin = w * word_bits, end = begin + word_bits - 1;
+            if (to < begin || from > end) return 0;
+            std::size_t width = std::min(to, end) - std::max(from, begin) + 1;
+            uint64_t bits = width == word_bits ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+            return bits << (std::max(from, begin) - begin);
+        };
+
+        if (lo <= hi)
+        {
+            out.assign_words(hi / word_bits + 1, [&](std::size_t w) { return ~a.word(w) & mask(w, lo, hi); });
+        }
+        else
+        {
+            out.assign_words(fixed_words, [&](std::size_t w)
+            {
+                return ~a.word(w) & (mask(w, lo, fixed_words * word_bits - 1) | mask(w, 0, hi));
+            });
+        }
+    }
+
+    // OR- и AND-свёртка всех операндов за один проход по кускам
+    static void unite_all(std::span<const BitmapStorage* const> sets, BitmapStorage& out)
+    {
+        std::size_t count = 0;
+        for (const BitmapStorage *set : sets) count = std::max(count, set->chunk_count());
+        reduce_all(sets, out, count, simd::bitmap_or, false);
+    }
+
+    static void intersect_all(std::span<const BitmapStorage* const> sets, BitmapStorage& out)
+    {
+        std::size_t count = sets[0]->chunk_count();
+        for (const BitmapStorage *set : sets) count = std::min(count, set->chunk_count());
+        reduce_all(sets, out, count, simd::bitmap_and, true);
+    }
+
+    static bool is_subset(const BitmapStorage& a, const BitmapStorage& b)
+    {
+        for (std::size_t c = 0; c < a.chunk_count(); c++)
+        {
+            const uint64_t *ca = a.chunk(c), *cb = b.chunk(c);
+            if (ca != cb && !simd::bitmap_is_subset(ca, cb, chunk_words)) return false;
+        }
+        return true;
+    }
+
+    static bool equal(const BitmapStorage& a, const BitmapStorage& b)
+    {
+        std::size_t count = std::max(a.chunk_count(), b.chunk_count());
+        for (std::size_t c = 0; c < count; c++)
+        {
+            const uint64_t *ca = a.chunk(c), *cb = b.chunk(c);
+            if (ca != cb && !simd::bitmap_equal(ca, cb, chunk_words)) return false;
+        }
+        return true;
+    }
+
+    // |a ∩ b| popcount'ом по словам без записи результата; пустые куски пропускаются,
+    // общий кусок считается один раз
+    static std::size_t intersect_count(const BitmapStorage& a, const BitmapStorage& b)
+    {
+        std::size_t result = 0;
+        for (std::size_t c = 0, count = std::min(a.chunk_count(), b.chunk_count()); c < count; c++)
+        {
+            const uint64_t *ca = a.chunk(c), *cb = b.chunk(c);
+            if (ca == zero_chunk() || cb == zero_chunk()) continue;
+            result += simd::bitmap_and_count(ca, cb, chunk_words);
+        }
+        return result;
+    }
+};
+
+// Отсортированный массив без повторов: подходит для разреженных множеств
+// больших целых идентификаторов и для любых упорядоченных типов (строки и т.п.).
+// Массив разделяется между множествами по счётчику ссылок и копируется при первой
+// записи; слияние, результат которого совпадает с операндом, ссылается на его массив.
+// Массив может смотреть в отображённый снимок, тогда копия делается так же при записи.
+template <typename T>
+class SortedVectorStorage
+{
+private:
+    std::shared_ptr<std::vector<T>> elems;
+
+    std::span<const T> view;
+    bool viewing = false;
+    std::shared_ptr<const void> view_owner;
+
+    // собственный массив, не разделённый ни с кем: его можно менять на месте
+    std::vector<T>& mutable_elems()
+    {
+        if (viewing)
+        {
+            elems = std::make_shared<std::vector<T>>(view.begin(), view.end());
+            viewing = false;
+            view = {};
+            view_owner.reset();
+        }
+        else if (!elems)
+        {
+            elems = std::make_shared<std::vector<T>>();
+        }
+        else if (elems.use_count() > 1)
+        {
+            elems = std::make_shared<std::vector<T>>(*elems);
+        }
+        return *elems;
+    }
+
+    void share(const SortedVectorStorage& source)
+    {
+        elems = source.elems;
+        view = source.view;
+        viewing = source.viewing;
+        view_owner = source.view_owner;
+    }
+
+    static bool includes(std::span<const T> large, std::span<const T> small)
+    {
+        return small.size() <= large.size() && std::includes(large.begin(), large.end(), small.begin(), small.end());
+    }
+
+    // Первая позиция не раньше from, где элемент не меньше value: шаги 1, 2, 4, ...
+    // до перелёта, затем двоичный поиск внутри последнего шага. Стоимость - логарифм
+    // расстояния до ответа, поэтому проход малого массива по большому почти линеен
+    // по малому.
+    static std::size_t gallop(std::span<const T> items, std::size_t from, const T& value)
+    {
+        std::size_t step = 1, lo = from, hi = from;
+        while (hi < items.size() && items[hi] < value)
+        {
+            lo = hi + 1;
+            hi += step;
+            step *= 2;
+        }
+        hi = std::min(hi, items.size());
+        return static_cast<std::size_t>(std::lower_bound(items.begin() + static_cast<std::ptrdiff_t>(lo),
+                                                         items.begin() + static_cast<std::ptrdiff_t>(hi), value) -
+                                        items.begin());
+    }
+
+public:
+    // элементы по возрастанию, свои или из отображённого снимка
+    std::span<const T> items() const
+    {
+        if (viewing) return view;
+        return elems ? std::span<const T>(*elems) : std::span<const T>();
+    }
+
+    // массив поверх чужой памяти; owner держит память живой
+    static SortedVectorStorage view_of(std::span<const T> data, std::shared_ptr<const void> owner)
+    {
+        SortedVectorStorage storage;
+        storage.view = data;
+        storage.viewing = true;
+        storage.view_owner = std::move(owner);
+        return storage;
+    }
+
+    bool is_view() const
+    {
+        return viewing;
+    }
+
+    bool contains(const T& value) const
+    {
+        std::span<const T> all = items();
+        return std::binary_search(all.begin(), all.end(), value);
+    }
+
+    bool insert(const T& value)
+    {
+        std::span<const T> all = items();
+        auto pos = std::lower_bound(all.begin(), all.end(), value);
+        if (pos != all.end() && !(value < *pos)) return false;
+        std::size_t index = static_cast<std::size_t>(pos - all.begin());
+        std::vector<T>& own = mutable_elems();
+        own.insert(own.begin() + static_cast<std::ptrdiff_t>(index), value);
+        return true;
+    }
+
+    bool erase(const T& value)
+    {
+        std::span<const T> all = items();
+        auto pos = std::lower_bound(all.begin(), all.end(), value);
+        if (pos == all.end() || value < *pos) return false;
+        std::size_t index = static_cast<std::size_t>(pos - all.begin());
+        std::vector<T>& own = mutable_elems();
+        own.erase(own.begin() + static_cast<std::ptrdiff_t>(index));
+        return true;
+    }
+
+    void clear()
+    {
+        viewing = false;
+        view = {};
+        view_owner.reset();
+        elems.reset();
+    }
+
+    void reserve(std::size_t n)
+    {
+        mutable_elems().reserve(n);
+    }
+
+    // value больше всех уже добавленных: дописывается в хвост за O(1)
+    void append_sorted(const T& value)
+    {
+        mutable_elems().push_back(value);
+    }
+
+    bool empty() const
+    {
+        return items().empty();
+    }
+
+    std::size_t size() const
+    {
+        return items().size();
+    }
+
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (const T& value : items()) f(value);
+    }
+
+public:
+    // Слияния идут одним проходом по обоим массивам и дописывают результат в хвост.
+    // Если результат равен одному из операндов (второй - его подмножество), результат
+    // ссылается на массив операнда без копирования. Это выясняется в том же проходе:
+    // пока не встретились элементы, которые дают разницу с обоими операндами, результат
+    // совпадает с началом одного из них и не записывается; после такого элемента это
+    // начало копируется одним куском, и проход продолжается с записью.
+    static void unite(const SortedVectorStorage& a, const SortedVectorStorage& b, SortedVectorStorage& out)
+    {
+        std::span<const T> sa = a.items(), sb = b.items();
+        auto ia = sa.begin(), ib = sb.begin();
+        bool only_in_a = false, only_in_b = false;
+        while (ia != sa.end() && ib != sb.end())
+        {
+            if (*ia < *ib)
+            {
+                if (only_in_b) break;
+                only_in_a = true;
+                ++ia;
+            }
+            else if (*ib < *ia)
+            {
+                if (only_in_a) break;
+                only_in_b = true;
+                ++ib;
+            }
+            else
+            {
+                ++ia;
+                ++ib;
+            }
+        }
+        if (!only_in_b && ib == sb.end())
+        {
+            out.share(a);
+            return;
+        }
+        if (!only_in_a && ia == sa.end())
+        {
+            out.share(b);
+            return;
+        }
+
+        std::vector<T> result;
+        result.reserve(sa.size() + sb.size());
+        if (only_in_b) result.assign(sb.begin(), ib);
+        else result.assign(sa.begin(), ia);
+        while (ia != sa.end() && ib != sb.end())
+        {
+            if (*ia < *ib)
+            {
+                result.push_back(*ia++);
+            }
+            else if (*ib < *ia)
+            {
+                result.push_back(*ib++);
+            }
+            else
+            {
+                result.push_back(*ia++);
+                ++ib;
+            }
+        }
+        result.insert(result.end(), ia, sa.end());
+        result.insert(result.end(), ib, sb.end());
+        out.clear();
+        out.elems = std::make_shared<std::vector<T>>(std::move(result));
+    }
+
+    static void intersect(const SortedVectorStorage& a, const SortedVectorStorage& b, SortedVectorStorage& out)
+    {
+        std::span<const T> sa = a.items(), sb = b.items();
+        auto ia = sa.begin(), ib = sb.begin();
+        bool only_in_a = false, only_in_b = false;
+        while (ia != sa.end() && ib != sb.end())
+        {
+            if (*ia < *ib)
+            {
+                if (only_in_b) break;
+                only_in_a = true;
+                ++ia;
+            }
+            else if (*ib < *ia)
+            {
+                if (only_in_a) break;
+                only_in_b = true;
+                ++ib;
+            }
+            else
+            {
+                ++ia;
+                ++ib;
+            }
+        }
+        if (!only_in_a && ia == sa.end())
+        {
+            out.share(a);
+            return;
+        }
+        if (!only_in_b && ib == sb.end())
+        {
+            out.share(b);
+            return;
+        }
+
+        // общие элементы до места остановки - начало того операнда, в котором не было лишних
+        std::vector<T> result;
+        if (only_in_a) result.assign(sb.begin(), ib);
+        else result.assign(sa.begin(), ia);
+        std::size_t done = result.size();
+        std::size_t rest_a = static_cast<std::size_t>(sa.end() - ia), rest_b = static_cast<std::size_t>(sb.end() - ib);
+        if constexpr (simd::has_vector_intersect<T>)
+        {
+            // векторное ядро пишет блоками по 4, поэтому запас в 4 элемента
+            result.resize(done + std::min(rest_a, rest_b) + 4);
+            std::size_t count = simd::intersect_sorted(sa.data() + (sa.size() - rest_a), rest_a,
+                                                       sb.data() + (sb.size() - rest_b), rest_b, result.data() + done);
+            result.resize(done + count);
+        }
+        else
+        {
+            result.reserve(done + std::min(rest_a, rest_b));
+            while (ia != sa.end() && ib != sb.end())
+            {
+                if (*ia < *ib)
+                {
+                    ++ia;
+                }
+                else if (*ib < *ia)
+                {
+                    ++ib;
+                }
+                else
+                {
+                    result.push_back(*ia++);
+                    ++ib;
+                }
+            }
+        }
+        out.clear();
+        if (!result.empty()) out.elems = std::make_shared<std::vector<T>>(std::move(result));
+    }
+
+    static void subtract(const SortedVectorStorage& a, const SortedVectorStorage& b, SortedVectorStorage& out)
+    {
+        std::span<const T> sa = a.items(), sb = b.items();
+        if (sb.empty())
+        {
+            out.share(a);
+            return;
+        }
+
+        out.clear();
+        std::vector<T> result;
+        result.reserve(sa.size());
+        auto ia = sa.begin(), ib = sb.begin();
+        while (ia != sa.end() && ib != sb.end())
+        {
+            if (*ia < *ib)
+            {
+                result.push_back(*ia++);
+            }
+            else if (*ib < *ia)
+            {
+                ++ib;
+            }
+            else
+            {
+                ++ia;
+                ++ib;
+            }
+        }
+        result.insert(result.end(), ia, sa.end());
+
+        // ничего не вычтено - результат совпадает с a
+        if (result.size() == sa.size())
+        {
+            out.share(a);
+            return;
+        }
+        if (!result.empty()) out.elems = std::make_shared<std::vector<T>>(std::move(result));
+    }
+
+    static void sym_difference(const SortedVectorStorage& a, const SortedVectorStorage& b, SortedVectorStorage& out)
+    {
+        std::span<const T> sa = a.items(), sb = b.items();
+        if (sb.empty())
+        {
+            out.share(a);
+            return;
+        }
+        if (sa.empty())
+        {
+            out.share(b);
+            return;
+        }
+
+        std::vector<T> result;
+        result.reserve(sa.size() + sb.size());
+        auto ia = sa.begin(), ib = sb.begin();
+        while (ia != sa.end() && ib != sb.end())
+        {
+            if (*ia < *ib)
+            {
+                result.push_back(*ia++);
+            }
+            else if (*ib < *ia)
+            {
+                result.push_back(*ib++);
+            }
+            else
+            {
+                ++ia;
+                ++ib;
+            }
+        }
+        result.insert(result.end(), ia, sa.end());
+        result.insert(result.end(), ib, sb.end());
+
+        out.clear();
+        if (!result.empty()) out.elems = std::make_shared<std::vector<T>>(std::move(result));
+    }
+
+    // k-путевое слияние попарно по турнирной схеме: за log2(k) раундов каждый элемент
+    // читается по разу в раунде, O(N log k) при общем размере N, а проходы остаются
+    // линейными. Каждый шаг - обычный unite, поэтому операнд, включающий другой,
+    // берётся по ссылке без копирования.
+    static void unite_all(std::span<const SortedVectorStorage* const> sets, SortedVectorStorage& out)
+    {
+        std::vector<SortedVectorStorage> level;
+        level.reserve(sets.size());
+        for (const SortedVectorStorage *set : sets) level.push_back(*set);
+        while (level.size() > 1)
+        {
+            std::vector<SortedVectorStorage> next((level.size() + 1) / 2);
+            for (std::size_t i = 0; i < level.size(); i += 2)
+            {
+                if (i + 1 < level.size()) unite(level[i], level[i + 1], next[i / 2]);
+                else next[i / 2] = std::move(level[i]);
+            }
+            level = std::move(next);
+        }
+        out = std::move(level.front());
+    }
+
+    // Операнды упорядочиваются по размеру; каждый элемент наименьшего ищется галопом
+    // в остальных по порядку, так что за весь проход каждый массив читается один раз,
+    // а промах в небольшом операнде отсекает элемент до обращения к большим.
+    static void intersect_all(std::span<const SortedVectorStorage* const> sets, SortedVectorStorage& out)
+    {
+        std::vector<const SortedVectorStorage*> order(sets.begin(), sets.end());
+        std::sort(order.begin(), order.end(),
+                  [](const SortedVectorStorage *x, const SortedVectorStorage *y) { return x->size() < y->size(); });
+        if (order.front()->empty())
+        {
+            out.clear();
+            return;
+        }
+
+        std::span<const T> smallest = order.front()->items();
+        std::vector<std::span<const T>> others;
+        for (std::size_t k = 1; k < order.size(); k++)
+        {
+            std::span<const T> items = order[k]->items();
+            if (items.data() != smallest.data()) others.push_back(items);
+        }
+        std::vector<std::size_t> pos(others.size(), 0);
+
+        std::vector<T> result;
+        result.reserve(smallest.size());
+        bool exhausted = false; // один из операндов кончился - дальше совпадений нет
+        for (std::size_t i = 0; i < smallest.size() && !exhausted; i++)
+        {
+            const T& value = smallest[i];
+            bool everywhere = true;
+            for (std::size_t k = 0; k < others.size() && everywhere; k++)
+            {
+                pos[k] = gallop(others[k], pos[k], value);
+                exhausted = pos[k] == others[k].size();
+                everywhere = !exhausted && !(value < others[k][pos[k]]);
+            }
+            if (everywhere) result.push_back(value);
+        }
+        if (result.size() == smallest.size())
+        {
+            out.share(*order.front());
+            return;
+        }
+        out.clear();
+        if (!result.empty()) out.elems = std::make_shared<std::vector<T>>(std::move(result));
+    }
+
+    static bool is_subset(const SortedVectorStorage& a, const SortedVectorStorage& b)
+    {
+        std::span<const T> sa = a.items(), sb = b.items();
+        if (sa.data() == sb.data() && sa.size() == sb.size()) return true;
+        return includes(sb, sa);
+    }
+
+    static bool equal(const SortedVectorStorage& a, const SortedVectorStorage& b)
+    {
+        std::span<const T> sa = a.items(), sb = b.items();
+        if (sa.data() == sb.data() && sa.size() == sb.size()) return true;
+        return std::equal(sa.begin(), sa.end(), sb.begin(), sb.end());
+    }
+
+    // |a ∩ b| подсчётом при слиянии (векторным ядром без записи совпадений); при сильно
+    // разных размерах меньший массив ищется в большем галопом
+    static std::size_t intersect_count(const SortedVectorStorage& a, const SortedVectorStorage& b)
+    {
+        std::span<const T> sa = a.items(), sb = b.items();
+        if (sa.data() == sb.data() && sa.size() == sb.size()) return sa.size();
+        if (sa.size() > sb.size()) std::swap(sa, sb);
+
+        if (sa.size() * 16 < sb.size())
+        {
+            std::size_t result = 0, from = 0;
+            for (const T& value : sa)
+            {
+                from = gallop(sb, from, value);
+                if (from == sb.size()) break;
+                if (!(value < sb[from])) result++;
+            }
+            return result;
+        }
+        return simd::intersect_sorted(sa.data(), sa.size(), sb.data(), sb.size(), static_cast<T*>(nullptr));
+    }
+};
+
+// Хеш-таблица с открытой адресацией и линейным пробированием.
+// Все элементы лежат в одном непрерывном массиве слотов: множество занимает одну
+// аллокацию, освобождается за одну операцию и обходится последовательно по памяти.
+// Удаление - обратным сдвигом, без надгробий. Порядок обхода не определён.
+template <typename T, typename Hash = std::hash<T>>
+class HashStorage
+{
+private:
+    struct Slot
+    {
+        T value{};
+        bool occupied = false;
+    };
+
+    std::vector<Slot> slots; // размер - степень двойки или 0
+    std::size_t count = 0;
+
+    std::size_t mask() const
+    {
+        return slots.size() - 1;
+    }
+
+    // перемешивание Фибоначчи: std::hash для целых - тождественная функция
+    std::size_t home(const T& value) const
+    {
+        uint64_t h = static_cast<uint64_t>(Hash{}(value)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>(h >> 32) & mask();
+    }
+
+    std::size_t find_slot(const T& value) const
+    {
+        std::size_t i = home(value);
+        while (slots[i].occupied && !(slots[i].value == value))
+        {
+            i = (i + 1) & mask();
+        }
+        return i;
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        std::vector<Slot> old = std::move(slots);
+        slots.assign(capacity, Slot{});
+        for (Slot& slot : old)
+        {
+            if (!slot.occupied) continue;
+            std::size_t i = find_slot(slot.value);
+            slots[i].value = std::move(slot.value);
+            slots[i].occupied = true;
+        }
+    }
+
+public:
+    // заполнение не выше 3/4
+    void reserve(std::size_t n)
+    {
+        std::size_t capacity = 8;
+        while (capacity * 3 < n * 4) capacity *= 2;
+        if (capacity > slots.size()) rehash(capacity);
+    }
+
+    bool contains(const T& value) const
+    {
+        return count != 0 && slots[find_slot(value)].occupied;
+    }
+
+    bool insert(const T& value)
+    {
+        reserve(count + 1);
+        std::size_t i = find_slot(value);
+        if (slots[i].occupied) return false;
+        slots[i].value = value;
+        slots[i].occupied = true;
+        count++;
+        return true;
+    }
+
+    bool erase(const T& value)
+    {
+        if (count == 0) return false;
+        std::size_t hole = find_slot(value);
+        if (!slots[hole].occupied) return false;
+
+        // сдвигаем назад элементы цепочки, чья домашняя позиция не лежит в (hole, j]
+        for (std::size_t j = (hole + 1) & mask(); slots[j].occupied; j = (j + 1) & mask())
+        {
+            std::size_t k = home(slots[j].value);
+            bool stays = hole <= j ? (hole < k && k <= j) : (hole < k || k <= j);
+            if (stays) continue;
+            slots[hole].value = std::move(slots[j].value);
+            hole = j;
+        }
+        slots[hole] = Slot{};
+        count--;
+        return true;
+    }
+
+    void clear()
+    {
+        slots.clear();
+        count = 0;
+    }
+
+    void append_sorted(const T& value)
+    {
+        insert(value);
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    std::size_t size() const
+    {
+        return count;
+    }
+
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (const Slot& slot : slots)
+        {
+            if (slot.occupied) f(slot.value);
+        }
+    }
+
+public:
+    static void unite(const HashStorage& a, const HashStorage& b, HashStorage& out)
+    {
+        out = a;
+        out.reserve(a.size() + b.size());
+        b.for_each([&out](const T& value) { out.insert(value); });
+    }
+
+    static void intersect(const HashStorage& a, const HashStorage& b, HashStorage& out)
+    {
+        const HashStorage& small = a.size() <= b.size() ? a : b;
+        const HashStorage& large = a.size() <= b.size() ? b : a;
+        out = HashStorage{};
+        out.reserve(small.size());
+        small.for_each([&](const T& value)
+        {
+            if (large.contains(value)) out.insert(value);
+        });
+    }
+
+    static void subtract(const HashStorage& a, const HashStorage& b, HashStorage& out)
+    {
+        out = HashStorage{};
+        out.reserve(a.size());
+        a.for_each([&](const T& value)
+        {
+            if (!b.contains(value)) out.insert(value);
+        });
+    }
+
+    static void sym_difference(const HashStorage& a, const HashStorage& b, HashStorage& out)
+    {
+        out = HashStorage{};
+        out.reserve(a.size() + b.size());
+        a.for_each([&](const T& value)
+        {
+            if (!b.contains(value)) out.insert(value);
+        });
+        b.for_each([&](const T& value)
+        {
+            if (!a.contains(value)) out.insert(value);
+        });
+    }
+
+    static void unite_all(std::span<const HashStorage* const> sets, HashStorage& out)
+    {
+        std::size_t total = 0;
+        for (const HashStorage *set : sets) total += set->size();
+        HashStorage result;
+        result.reserve(total);
+        for (const HashStorage *set : sets)
+        {
+            set->for_each([&result](const T& value) { result.insert(value); });
+        }
+        out = std::move(result);
+    }
+
+    // элементы наименьшего операнда проверяются по остальным, от меньших к большим
+    static void intersect_all(std::span<const HashStorage* const> sets, HashStorage& out)
+    {
+        std::vector<const HashStorage*> order(sets.begin(), sets.end());
+        std::sort(order.begin(), order.end(),
+                  [](const HashStorage *x, const HashStorage *y) { return x->size() < y->size(); });
+        HashStorage result;
+        result.reserve(order.front()->size());
+        order.front()->for_each([&](const T& value)
+        {
+            for (std::size_t k = 1; k < order.size(); k++)
+            {
+                if (!order[k]->contains(value)) return;
+            }
+            result.insert(value);
+        });
+        out = std::move(result);
+    }
+
+    static bool is_subset(const HashStorage& a, const HashStorage& b)
+    {
+        if (a.size() > b.size()) return false;
+        for (const Slot& slot : a.slots)
+        {
+            if (slot.occupied && !b.contains(slot.value)) return false;
+        }
+        return true;
+    }
+
+    static bool equal(const HashStorage& a, const HashStorage& b)
+    {
+        return a.size() == b.size() && is_subset(a, b);
+    }
+
+    static std::size_t intersect_count(const HashStorage& a, const HashStorage& b)
+    {
+        const HashStorage& small = a.size() <= b.size() ? a : b;
+        const HashStorage& large = a.size() <= b.size() ? b : a;
+        std::size_t result = 0;
+        small.for_each([&](const T& value) { result += large.contains(value); });
+        return result;
+    }
+};
+
+#endif //DISCRETE_MATHEMATICS_SET_STORAGE_H
@@ -0,0 +1,560 @@
+#ifndef DISCRETE_MATHEMATICS_SIMD_KERNELS_H
+#define DISCRETE_MATHEMATICS_SIMD_KERNELS_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SET_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SET_SIMD_X86 0
+#endif
+
+// Векторные ядра операций над множествами с выбором реализации во время работы:
+// при первом обращении проверяются возможности процессора (AVX2, SSE4.2, POPCNT) и
+// в таблицу ядер записываются самые широкие доступные варианты. Скалярные версии
+// работают везде, поэтому один бинарник запускается на любом x86 и не только.
+// Переменная окружения SET_SIMD=scalar|sse42|avx2 ограничивает уровень сверху.
+namespace simd
+{
+    enum class Level
+    {
+        scalar,
+        sse42,
+        avx2
+    };
+
+    inline const char *level_name(Level level)
+    {
+        switch (level)
+        {
+            case Level::avx2: return "avx2";
+            case Level::sse42: return "sse4.2";
+            default: return "scalar";
+        }
+    }
+
+    // ---------------- скалярные версии ----------------
+
+    namespace scalar
+    {
+        inline void bitmap_or(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; i++) out[i] = a[i] | b[i];
+        }
+
+        inline void bitmap_and(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; i++) out[i] = a[i] & b[i];
+        }
+
+        inline void bitmap_andnot(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; i++) out[i] = a[i] & ~b[i];
+        }
+
+        inline void bitmap_xor(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; i++) out[i] = a[i] ^ b[i];
+        }
+
+        inline bool bitmap_is_subset(const uint64_t *a, const uint64_t *b, std::size_t n)
+        {
+            uint64_t extra = 0;
+            for (std::size_t i = 0; i < n; i++) extra |= a[i] & ~b[i];
+            return extra == 0;
+        }
+
+        inline bool bitmap_equal(const uint64_t *a, const uint64_t *b, std::size_t n)
+        {
+            uint64_t diff = 0;
+            for (std::size_t i = 0; i < n; i++) diff |= a[i] ^ b[i];
+            return diff == 0;
+        }
+
+        // число единичных бит и число серий подряд идущих единиц (для roaring-контейнеров)
+        inline std::size_t bitmap_count(const uint64_t *words, std::size_t n, std::size_t *runs)
+        {
+            std::size_t bits = 0, starts = 0;
+            uint64_t carry = 0; // старший бит предыдущего слова
+            for (std::size_t i = 0; i < n; i++)
+            {
+                uint64_t w = words[i];
+                bits += std::popcount(w);
+                starts += std::popcount(w & ~((w << 1) | carry));
+                carry = w >> 63;
+            }
+            *runs = starts;
+            return bits;
+        }
+
+        // мощность пересечения: число единичных бит a & b без записи результата
+        inline std::size_t bitmap_and_count(const uint64_t *a, const uint64_t *b, std::size_t n)
+        {
+            std::size_t bits = 0;
+            for (std::size_t i = 0; i < n; i++) bits += std::popcount(a[i] & b[i]);
+            return bits;
+        }
+
+        // пересечение отсортированных массивов без повторов, out вмещает min(na, nb) + 4;
+        // при out == nullptr совпадения только считаются
+        template <typename T>
+        std::size_t intersect_sorted(const T *a, std::size_t na, const T *b, std::size_t nb, T *out)
+        {
+            std::size_t i = 0, j = 0, count = 0;
+            while (i < na && j < nb)
+            {
+                if (a[i] < b[j]) i++;
+                else if (b[j] < a[i]) j++;
+                else
+                {
+                    if (out != nullptr) out[count] = a[i];
+                    count++;
+                    i++;
+                    j++;
+                }
+            }
+            return count;
+        }
+    }
+
+#if SET_SIMD_X86
+    // ---------------- SSE4.2: 128 бит ----------------
+
+    namespace sse42
+    {
+        __attribute__((target("sse4.2")))
+        inline void bitmap_or(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2)
+            {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(va, vb));
+            }
+            scalar::bitmap_or(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("sse4.2")))
+        inline void bitmap_and(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2)
+            {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_and_si128(va, vb));
+            }
+            scalar::bitmap_and(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("sse4.2")))
+        inline void bitmap_andnot(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2)
+            {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_andnot_si128(vb, va));
+            }
+            scalar::bitmap_andnot(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("sse4.2")))
+        inline void bitmap_xor(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2)
+            {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(va, vb));
+            }
+            scalar::bitmap_xor(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("sse4.2")))
+        inline bool bitmap_is_subset(const uint64_t *a, const uint64_t *b, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2)
+            {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                // testc: (~va & vb) == 0 для пары (vb, va) означает va ⊆ vb
+                if (!_mm_testc_si128(vb, va)) return false;
+            }
+            return scalar::bitmap_is_subset(a + i, b + i, n - i);
+        }
+
+        __attribute__((target("sse4.2")))
+        inline bool bitmap_equal(const uint64_t *a, const uint64_t *b, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2)
+            {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                __m128i diff = _mm_xor_si128(va, vb);
+                if (!_mm_testz_si128(diff, diff)) return false;
+            }
+            return scalar::bitmap_equal(a + i, b + i, n - i);
+        }
+
+        // popcnt 64-битного слова; на 32-битном x86 есть только _mm_popcnt_u32 - по половинам
+        __attribute__((target("popcnt")))
+        inline std::size_t popcount64(uint64_t w)
+        {
+#if defined(__x86_64__)
+            return static_cast<std::size_t>(_mm_popcnt_u64(w));
+#else
+            return static_cast<std::size_t>(_mm_popcnt_u32(static_cast<uint32_t>(w)) +
+                                            _mm_popcnt_u32(static_cast<uint32_t>(w >> 32)));
+#endif
+        }
+
+        // то же, что scalar::bitmap_count, но на аппаратной инструкции popcnt
+        __attribute__((target("sse4.2,popcnt")))
+        inline std::size_t bitmap_count(const uint64_t *words, std::size_t n, std::size_t *runs)
+        {
+            std::size_t bits = 0, starts = 0;
+            uint64_t carry = 0;
+            for (std::size_t i = 0; i < n; i++)
+            {
+                uint64_t w = words[i];
+                bits += popcount64(w);
+                starts += popcount64(w & ~((w << 1) | carry));
+                carry = w >> 63;
+            }
+            *runs = starts;
+            return bits;
+        }
+
+        __attribute__((target("sse4.2,popcnt")))
+        inline std::size_t bitmap_and_count(const uint64_t *a, const uint64_t *b, std::size_t n)
+        {
+            std::size_t bits = 0;
+            for (std::size_t i = 0; i < n; i++) bits += popcount64(a[i] & b[i]);
+            return bits;
+        }
+
+        // маска совпавших дорожек -> перестановка байт, сдвигающая их в начало регистра
+        inline const std::array<std::array<uint8_t, 16>, 16>& compact_shuffle()
+        {
+            static const std::array<std::array<uint8_t, 16>, 16> table = []
+            {
+                std::array<std::array<uint8_t, 16>, 16> t{};
+                for (int mask = 0; mask < 16; mask++)
+                {
+                    t[mask].fill(0x80);
+                    int pos = 0;
+                    for (int lane = 0; lane < 4; lane++)
+                    {
+                        if (!(mask & (1 << lane))) continue;
+                        for (int byte = 0; byte < 4; byte++)
+                        {
+                            t[mask][pos * 4 + byte] = static_cast<uint8_t>(lane * 4 + byte);
+                        }
+                        pos++;
+                    }
+                }
+                return t;
+            }();
+            return table;
+        }
+
+        // Пересечение отсортированных 32-битных массивов (схема Катсова/Лемира):
+        // блок из 4 элементов a сравнивается со всеми 4 циклическими сдвигами блока b,
+        // совпадения упаковываются через pshufb, затем сдвигается блок с меньшим максимумом.
+        template <typename T>
+        __attribute__((target("sse4.2")))
+        std::size_t intersect_sorted(const T *a, std::size_t na, const T *b, std::size_t nb, T *out)
+        {
+            static_assert(sizeof(T) == 4, "векторное пересечение работает с 32-битными элементами");
+            const auto& shuffle = compact_shuffle();
+
+            std::size_t i = 0, j = 0, count = 0;
+            const std::size_t end_a = na & ~std::size_t{3};
+            const std::size_t end_b = nb & ~std::size_t{3};
+            while (i < end_a && j < end_b)
+            {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+
+                __m128i cmp0 = _mm_cmpeq_epi32(va, vb);
+                __m128i cmp1 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)));
+                __m128i cmp2 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)));
+                __m128i cmp3 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)));
+                __m128i any = _mm_or_si128(_mm_or_si128(cmp0, cmp1), _mm_or_si128(cmp2, cmp3));
+
+                int mask = _mm_movemask_ps(_mm_castsi128_ps(any));
+                if (out != nullptr)
+                {
+                    __m128i packed = _mm_shuffle_epi8(
+                        va, _mm_loadu_si128(reinterpret_cast<const __m128i*>(shuffle[mask].data())));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + count), packed);
+                }
+                count += std::popcount(static_cast<unsigned>(mask));
+
+                T max_a = a[i + 3];
+                T max_b = b[j + 3];
+                if (!(max_b < max_a)) i += 4;
+                if (!(max_a < max_b)) j += 4;
+            }
+            return count + scalar::intersect_sorted(a + i, na - i, b + j, nb - j, out != nullptr ? out + count : nullptr);
+        }
+    }
+
+    // ---------------- AVX2: 256 бит ----------------
+
+    namespace avx2
+    {
+        __attribute__((target("avx2")))
+        inline void bitmap_or(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_or_si256(va, vb));
+            }
+            scalar::bitmap_or(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        inline void bitmap_and(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_and_si256(va, vb));
+            }
+            scalar::bitmap_and(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        inline void bitmap_andnot(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_andnot_si256(vb, va));
+            }
+            scalar::bitmap_andnot(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        inline void bitmap_xor(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(va, vb));
+            }
+            scalar::bitmap_xor(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        inline bool bitmap_is_subset(const uint64_t *a, const uint64_t *b, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+                if (!_mm256_testc_si256(vb, va)) return false;
+            }
+            return scalar::bitmap_is_subset(a + i, b + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        inline bool bitmap_equal(const uint64_t *a, const uint64_t *b, std::size_t n)
+        {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+                __m256i diff = _mm256_xor_si256(va, vb);
+                if (!_mm256_testz_si256(diff, diff)) return false;
+            }
+            return scalar::bitmap_equal(a + i, b + i, n - i);
+        }
+    }
+#endif
+
+    // ---------------- выбор реализации ----------------
+
+    struct Kernels
+    {
+        Level level;
+        void (*bitmap_or)(const uint64_t*, const uint64_t*, uint64_t*, std::size_t);
+        void (*bitmap_and)(const uint64_t*, const uint64_t*, uint64_t*, std::size_t);
+        void (*bitmap_andnot)(const uint64_t*, const uint64_t*, uint64_t*, std::size_t);
+        void (*bitmap_xor)(const uint64_t*, const uint64_t*, uint64_t*, std::size_t);
+        bool (*bitmap_is_subset)(const uint64_t*, const uint64_t*, std::size_t);
+        bool (*bitmap_equal)(const uint64_t*, const uint64_t*, std::size_t);
+        std::size_t (*bitmap_count)(const uint64_t*, std::size_t, std::size_t*);
+        std::size_t (*bitmap_and_count)(const uint64_t*, const uint64_t*, std::size_t);
+        std::size_t (*intersect_u32)(const uint32_t*, std::size_t, const uint32_t*, std::size_t, uint32_t*);
+        std::size_t (*intersect_i32)(const int32_t*, std::size_t, const int32_t*, std::size_t, int32_t*);
+    };
+
+    inline Level detect_level()
+    {
+        Level level = Level::scalar;
+#if SET_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) level = Level::avx2;
+        else if (__builtin_cpu_supports("sse4.2")) level = Level::sse42;
+#endif
+        if (const char *env = std::getenv("SET_SIMD"))
+        {
+            Level cap = Level::avx2;
+            if (std::strcmp(env, "scalar") == 0) cap = Level::scalar;
+            else if (std::strcmp(env, "sse42") == 0) cap = Level::sse42;
+            if (cap < level) level = cap;
+        }
+        return level;
+    }
+
+    // POPCNT - отдельный флаг CPUID, SSE4.2 его не гарантирует
+    inline bool detect_popcnt()
+    {
+#if SET_SIMD_X86
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("popcnt");
+#else
+        return false;
+#endif
+    }
+
+    // ядра подсчёта берутся из sse42 только при popcnt, иначе остаются скалярными
+    inline Kernels make_kernels(Level level, bool popcnt)
+    {
+        Kernels k{Level::scalar,
+                  scalar::bitmap_or, scalar::bitmap_and, scalar::bitmap_andnot, scalar::bitmap_xor,
+                  scalar::bitmap_is_subset, scalar::bitmap_equal, scalar::bitmap_count,
+                  scalar::bitmap_and_count,
+                  scalar::intersect_sorted<uint32_t>, scalar::intersect_sorted<int32_t>};
+#if SET_SIMD_X86
+        if (level >= Level::sse42)
+        {
+            k = {Level::sse42,
+                 sse42::bitmap_or, sse42::bitmap_and, sse42::bitmap_andnot, sse42::bitmap_xor,
+                 sse42::bitmap_is_subset, sse42::bitmap_equal, scalar::bitmap_count,
+                 scalar::bitmap_and_count,
+                 sse42::intersect_sorted<uint32_t>, sse42::intersect_sorted<int32_t>};
+            if (popcnt)
+            {
+                k.bitmap_count = sse42::bitmap_count;
+                k.bitmap_and_count = sse42::bitmap_and_count;
+            }
+        }
+        if (level >= Level::avx2)
+        {
+            k.level = Level::avx2;
+            k.bitmap_or = avx2::bitmap_or;
+            k.bitmap_and = avx2::bitmap_and;
+            k.bitmap_andnot = avx2::bitmap_andnot;
+            k.bitmap_xor = avx2::bitmap_xor;
+            k.bitmap_is_subset = avx2::bitmap_is_subset;
+            k.bitmap_equal = avx2::bitmap_equal;
+        }
+#else
+        (void)level;
+        (void)popcnt;
+#endif
+        return k;
+    }
+
+    inline const Kernels& kernels()
+    {
+        static const Kernels table = make_kernels(detect_level(), detect_popcnt());
+        return table;
+    }
+
+    inline Level active_level()
+    {
+        return kernels().level;
+    }
+
+    inline void bitmap_or(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+    {
+        kernels().bitmap_or(a, b, out, n);
+    }
+
+    inline void bitmap_and(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+    {
+        kernels().bitmap_and(a, b, out, n);
+    }
+
+    inline void bitmap_andnot(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+    {
+        kernels().bitmap_andnot(a, b, out, n);
+    }
+
+    inline void bitmap_xor(const uint64_t *a, const uint64_t *b, uint64_t *out, std::size_t n)
+    {
+        kernels().bitmap_xor(a, b, out, n);
+    }
+
+    inline bool bitmap_is_subset(const uint64_t *a, const uint64_t *b, std::size_t n)
+    {
+        return kernels().bitmap_is_subset(a, b, n);
+    }
+
+    inline bool bitmap_equal(const uint64_t *a, const uint64_t *b, std::size_t n)
+    {
+        return kernels().bitmap_equal(a, b, n);
+    }
+
+    inline std::size_t bitmap_count(const uint64_t *words, std::size_t n, std::size_t *runs)
+    {
+        return kernels().bitmap_count(words, n, runs);
+    }
+
+    inline std::size_t bitmap_and_count(const uint64_t *a, const uint64_t *b, std::size_t n)
+    {
+        return kernels().bitmap_and_count(a, b, n);
+    }
+
+    template <typename T>
+    constexpr bool has_vector_intersect = std::is_same_v<T, uint32_t> || std::is_same_v<T, int32_t>;
+
+    // out должен вмещать min(na, nb) + 4 элемента: векторная версия пишет блоками по 4;
+    // out == nullptr - только подсчёт совпадений
+    template <typename T>
+    std::size_t intersect_sorted(const T *a, std::size_t na, const T *b, std::size_t nb, T *out)
+    {
+        if constexpr (std::is_same_v<T, uint32_t>)
+        {
+            return kernels().intersect_u32(a, na, b, nb, out);
+        }
+        else if constexpr (std::is_same_v<T, int32_t>)
+        {
+            return kernels().intersect_i32(a, na, b, nb, out);
+        }
+        else
+        {
+            return scalar::intersect_sorted(a, na, b, nb, out);
+        }
+    }
+}
+
+#endif //DISCRETE_MATHEMATICS_SIMD_KERNELS_H
@@ -0,0 +1,353 @@
+#ifndef DISCRETE_MATHEMATICS_SNAPSHOT_H
+#define DISCRETE_MATHEMATICS_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "set_storage.h"
+
+// Снимок реестра множеств на диске.
+//
+//   SnapshotHeader                      заголовок (48 байт)
+//   SnapshotEntry[set_count]            индекс: имя и расположение данных каждого множества
+//   имена подряд, без завершающих нулей
+//   данные множеств, каждое выровнено на 64 байта:
+//     битовая карта - слова uint64_t, отсортированный массив - элементы T
+//
+// Числа записаны в порядке байт машины (little-endian на x86). Файл открывается
+// отображением в память, и загруженные множества читают данные прямо из него.
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t set_count;
+    uint32_t kind;         // SnapshotKind
+    uint32_t element_size; // sizeof(T)
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint64_t file_size;
+};
+
+struct SnapshotEntry
+{
+    uint64_t name_offset; // от начала блока имён
+    uint64_t name_length;
+    uint64_t payload_offset; // от начала файла
+    uint64_t payload_count;  // слов битовой карты или элементов массива
+};
+
+static_assert(sizeof(SnapshotHeader) == 48 && sizeof(SnapshotEntry) == 32, "формат снимка фиксирован");
+
+enum class SnapshotKind : uint32_t
+{
+    bitmap = 1,
+    sorted_array = 2
+};
+
+inline constexpr char snapshot_magic[8] = {'S', 'E', 'T', 'S', 'N', 'A', 'P', '1'};
+inline constexpr uint32_t snapshot_version = 1;
+inline constexpr uint64_t snapshot_alignment = 64;
+
+// Файл, отображённый в память только для чтения.
+class MappedFile
+{
+private:
+    const std::byte *data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    MappedFile() = default;
+
+public:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    static std::shared_ptr<MappedFile> open(const std::string& path)
+    {
+        std::shared_ptr<MappedFile> mapped(new MappedFile());
+#ifdef _WIN32
+        mapped->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (mapped->file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("не удалось открыть файл " + path);
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(mapped->file, &size);
+        mapped->size_ = static_cast<std::size_t>(size.QuadPart);
+        if (mapped->size_ == 0) return mapped;
+        mapped->mapping = CreateFileMappingA(mapped->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        const void *view = mapped->mapping ? MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (view == nullptr)
+        {
+            throw std::runtime_error("не удалось отобразить файл " + path);
+        }
+        mapped->data_ = static_cast<const std::byte*>(view);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("не удалось открыть файл " + path);
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("не удалось прочитать размер файла " + path);
+        }
+        mapped->size_ = static_cast<std::size_t>(info.st_size);
+        if (mapped->size_ != 0)
+        {
+            void *view = mmap(nullptr, mapped->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("не удалось отобразить файл " + path);
+            }
+            mapped->data_ = static_cast<const std::byte*>(view);
+        }
+        ::close(fd);
+#endif
+        return mapped;
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (data_ != nullptr) UnmapViewOfFile(data_);
+        if (mapping != nullptr) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (data_ != nullptr) munmap(const_cast<std::byte*>(data_), size_);
+#endif
+    }
+
+    const std::byte *data() const
+    {
+        return data_;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+};
+
+// Кодирование хранилища в снимок и обратно, по политике хранения.
+// Хеш-хранилище в снимки не пишется: у него нет формы, пригодной для чтения на месте.
+template <typename Storage>
+struct SnapshotCodec;
+
+template <typename T>
+struct SnapshotCodec<BitmapStorage<T>>
+{
+    static constexpr SnapshotKind kind = SnapshotKind::bitmap;
+    static constexpr std::size_t unit_size = sizeof(uint64_t);
+
+    static std::size_t count(const BitmapStorage<T>& storage)
+    {
+        return storage.word_count();
+    }
+
+    static void write(std::ostream& out, const BitmapStorage<T>& storage)
+    {
+        std::vector<uint64_t> words(storage.word_count());
+        for (std::size_t i = 0; i < words.size(); i++) words[i] = storage.word(i);
+        out.write(reinterpret_cast<const char*>(words.data()), static_cast<std::streamsize>(words.size() * unit_size));
+    }
+
+    static BitmapStorage<T> view(const std::byte *data, std::size_t count, std::shared_ptr<const void> owner)
+    {
+        return BitmapStorage<T>::view_of(reinterpret_cast<const uint64_t*>(data), count, std::move(owner));
+    }
+};
+
+template <typename T>
+struct SnapshotCodec<SortedVectorStorage<T>>
+{
+    static_assert(std::is_trivially_copyable_v<T>, "в снимок пишутся только тривиально копируемые элементы");
+
+    static constexpr SnapshotKind kind = SnapshotKind::sorted_array;
+    static constexpr std::size_t unit_size = sizeof(T);
+
+    static std::size_t count(const SortedVectorStorage<T>& storage)
+    {
+        return storage.size();
+    }
+
+    static void write(std::ostream& out, const SortedVectorStorage<T>& storage)
+    {
+        std::span<const T> items = storage.items();
+        out.write(reinterpret_cast<const char*>(items.data()), static_cast<std::streamsize>(items.size_bytes()));
+    }
+
+    static SortedVectorStorage<T> view(const std::byte *data, std::size_t count, std::shared_ptr<const void> owner)
+    {
+        return SortedVectorStorage<T>::view_of(std::span<const T>(reinterpret_cast<const T*>(data), count),
+                                               std::move(owner));
+    }
+};
+
+// Одно множество из снимка: имя и участок данных внутри отображения.
+struct SnapshotRecord
+{
+    std::string_view name;
+    const std::byte *payload;
+    std::size_t count;
+};
+
+inline uint64_t snapshot_align(uint64_t offset)
+{
+    return (offset + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment;
+}
+
+// Записывает снимок. sets - пары (имя, хранилище) в порядке реестра.
+template <typename Storage, typename T>
+void write_snapshot(const std::string& path, const std::vector<std::pair<std::string, const Storage*>>& sets)
+{
+    using Codec = SnapshotCodec<Storage>;
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = snapshot_version;
+    header.set_count = static_cast<uint32_t>(sets.size());
+    header.kind = static_cast<uint32_t>(Codec::kind);
+    header.element_size = sizeof(T);
+    header.names_offset = sizeof(SnapshotHeader) + sets.size() * sizeof(SnapshotEntry);
+
+    std::vector<SnapshotEntry> entries(sets.size());
+    std::string names;
+    for (std::size_t i = 0; i < sets.size(); i++)
+    {
+        entries[i].name_offset = names.size();
+        entries[i].name_length = sets[i].first.size();
+        names += sets[i].first;
+    }
+    header.names_size = names.size();
+
+    uint64_t offset = header.names_offset + names.size();
+    for (std::size_t i = 0; i < sets.size(); i++)
+    {
+        offset = snapshot_align(offset);
+        entries[i].payload_offset = offset;
+        entries[i].payload_count = Codec::count(*sets[i].second);
+        offset += entries[i].payload_count * Codec::unit_size;
+    }
+    header.file_size = offset;
+
+    // пишем во временный файл и подменяем им старый: старый снимок может быть
+    // отображён в память, и обрезать его на месте нельзя
+    const std::string temp_path = path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        throw std::runtime_error("не удалось открыть файл " + temp_path);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()),
+              static_cast<std::streamsize>(entries.size() * sizeof(SnapshotEntry)));
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+    uint64_t written = header.names_offset + names.size();
+    static const char padding[snapshot_alignment] = {};
+    for (std::size_t i = 0; i < sets.size(); i++)
+    {
+        out.write(padding, static_cast<std::streamsize>(entries[i].payload_offset - written));
+        Codec::write(out, *sets[i].second);
+        written = entries[i].payload_offset + entries[i].payload_count * Codec::unit_size;
+    }
+
+    out.close();
+    if (!out.good())
+    {
+        throw std::runtime_error("ошибка записи в файл " + temp_path);
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error)
+    {
+        throw std::runtime_error("не удалось заменить файл " + path + ": " + error.message());
+    }
+}
+
+// Проверяет заголовок и индекс отображённого снимка и возвращает записи о множествах.
+template <typename Storage, typename T>
+std::vector<SnapshotRecord> read_snapshot_index(const MappedFile& file)
+{
+    using Codec = SnapshotCodec<Storage>;
+
+    auto fail = [](const char *what) { throw std::runtime_error(std::string("повреждённый снимок: ") + what); };
+
+    if (file.size() < sizeof(SnapshotHeader)) fail("файл слишком короткий");
+    SnapshotHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0) fail("неверная сигнатура");
+    if (header.version != snapshot_version) fail("неизвестная версия");
+    if (header.file_size != file.size()) fail("размер не совпадает с заголовком");
+    if (header.kind != static_cast<uint32_t>(Codec::kind) || header.element_size != sizeof(T))
+    {
+        throw std::runtime_error("снимок содержит множества другого типа");
+    }
+
+    uint64_t index_end = sizeof(SnapshotHeader) + uint64_t{header.set_count} * sizeof(SnapshotEntry);
+    // поля заголовка недоверенные: сравнение с оставшимся местом, а не сумма, которая может переполниться
+    if (index_end > file.size() || header.names_offset != index_end ||
+        header.names_size > file.size() - header.names_offset)
+    {
+        fail("индекс выходит за пределы файла");
+    }
+
+    std::vector<SnapshotRecord> records;
+    records.reserve(header.set_count);
+    const char *names = reinterpret_cast<const char*>(file.data() + header.names_offset);
+    for (uint32_t i = 0; i < header.set_count; i++)
+    {
+        SnapshotEntry entry;
+        std::memcpy(&entry, file.data() + sizeof(SnapshotHeader) + i * sizeof(SnapshotEntry), sizeof(entry));
+        if (entry.name_length > header.names_size || entry.name_offset > header.names_size - entry.name_length)
+        {
+            fail("имя выходит за пределы блока имён");
+        }
+        if (entry.payload_offset % snapshot_alignment != 0) fail("данные не выровнены");
+        if (entry.payload_offset > file.size() ||
+            entry.payload_count > (file.size() - entry.payload_offset) / Codec::unit_size)
+        {
+            fail("данные выходят за пределы файла");
+        }
+        records.push_back({std::string_view(names + entry.name_offset, entry.name_length),
+                           file.data() + entry.payload_offset, static_cast<std::size_t>(entry.payload_count)});
+    }
+    return records;
+}
+
+#endif //DISCRETE_MATHEMATICS_SNAPSHOT_H
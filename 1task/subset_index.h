@@ -0,0 +1,179 @@
+#ifndef DISCRETE_MATHEMATICS_SUBSET_INDEX_H
+#define DISCRETE_MATHEMATICS_SUBSET_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Индекс включений между множествами: отвечает, какие множества являются
+// подмножествами или надмножествами данного, строит диаграмму Хассе отношения ⊂
+// и находит максимальные и минимальные множества.
+// Для каждого множества хранятся мощность и сигнатура (SetT::Signature - по биту на
+// элемент по его хешу). У подмножества мощность не больше и сигнатура вкладывается
+// в сигнатуру надмножества, поэтому почти все пары отсекаются сравнением нескольких
+// слов; поэлементная проверка is_subset_of идёт только для прошедших фильтр.
+// Записи упорядочены по мощности: подмножества ищутся среди меньших, надмножества -
+// среди больших. Индекс - снимок на момент построения; множества, изменённые после
+// него, нужно проиндексировать заново.
+template <typename SetT>
+class SubsetIndex
+{
+public:
+    using Signature = typename SetT::Signature;
+
+private:
+    struct Entry
+    {
+        SetT *set;
+        std::size_t size;
+        Signature signature;
+    };
+
+    std::vector<Entry> entries; // по возрастанию мощности, при равной - в исходном порядке
+
+    static bool signature_fits(const Signature& small, const Signature& large)
+    {
+        for (std::size_t i = 0; i < small.size(); i++)
+        {
+            if (small[i] & ~large[i]) return false;
+        }
+        return true;
+    }
+
+    // a ⊆ b: сначала фильтр по мощности и сигнатуре, затем точная проверка
+    static bool contained(const Entry& a, const Entry& b)
+    {
+        return a.size <= b.size && signature_fits(a.signature, b.signature) && a.set->is_subset_of(*b.set);
+    }
+
+    Entry entry_of(const SetT& set) const
+    {
+        return {const_cast<SetT*>(&set), set.size(), set.signature()};
+    }
+
+    // номер первой записи с мощностью не меньше size / больше size
+    std::size_t first_with_size(std::size_t size) const
+    {
+        return static_cast<std::size_t>(
+            std::lower_bound(entries.begin(), entries.end(), size,
+                             [](const Entry& e, std::size_t s) { return e.size < s; }) - entries.begin());
+    }
+
+    std::size_t first_above_size(std::size_t size) const
+    {
+        return static_cast<std::size_t>(
+            std::upper_bound(entries.begin(), entries.end(), size,
+                             [](std::size_t s, const Entry& e) { return s < e.size; }) - entries.begin());
+    }
+
+    // strict[i] - номера записей, строго содержащих запись i (a ⊂ b)
+    std::vector<std::vector<std::size_t>> strict_supersets() const
+    {
+        std::vector<std::vector<std::size_t>> result(entries.size());
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            for (std::size_t j = first_above_size(entries[i].size); j < entries.size(); j++)
+            {
+                if (contained(entries[i], entries[j])) result[i].push_back(j);
+            }
+        }
+        return result;
+    }
+
+public:
+    explicit SubsetIndex(const std::vector<SetT*>& sets)
+    {
+        entries.reserve(sets.size());
+        for (SetT *set : sets) entries.push_back(entry_of(*set));
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const Entry& a, const Entry& b) { return a.size < b.size; });
+    }
+
+    std::size_t size() const
+    {
+        return entries.size();
+    }
+
+    // проиндексированные множества S ≠ x, для которых S ⊆ x
+    std::vector<SetT*> subsets_of(const SetT& x) const
+    {
+        Entry target = entry_of(x);
+        std::vector<SetT*> result;
+        for (std::size_t i = 0, end = first_above_size(target.size); i < end; i++)
+        {
+            if (entries[i].set != &x && contained(entries[i], target)) result.push_back(entries[i].set);
+        }
+        return result;
+    }
+
+    // проиндексированные множества S ≠ x, для которых x ⊆ S
+    std::vector<SetT*> supersets_of(const SetT& x) const
+    {
+        Entry target = entry_of(x);
+        std::vector<SetT*> result;
+        for (std::size_t i = first_with_size(target.size); i < entries.size(); i++)
+        {
+            if (entries[i].set != &x && contained(target, entries[i])) result.push_back(entries[i].set);
+        }
+        return result;
+    }
+
+    // Рёбра диаграммы Хассе: пары (A, B), где A ⊂ B и нет C с A ⊂ C ⊂ B.
+    // Остальные включения получаются транзитивно. Равные множества рёбрами не связаны.
+    std::vector<std::pair<SetT*, SetT*>> covers() const
+    {
+        std::vector<std::vector<std::size_t>> above = strict_supersets();
+        std::vector<std::pair<SetT*, SetT*>> result;
+        std::vector<bool> reachable(entries.size());
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            // j покрывает i, если j не лежит выше другого надмножества i
+            std::fill(reachable.begin(), reachable.end(), false);
+            for (std::size_t k : above[i])
+            {
+                for (std::size_t j : above[k]) reachable[j] = true;
+            }
+            for (std::size_t j : above[i])
+            {
+                if (!reachable[j]) result.emplace_back(entries[i].set, entries[j].set);
+            }
+        }
+        return result;
+    }
+
+    // множества, не содержащиеся строго ни в одном другом
+    std::vector<SetT*> maximal() const
+    {
+        std::vector<SetT*> result;
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            bool covered = false;
+            for (std::size_t j = first_above_size(entries[i].size); j < entries.size() && !covered; j++)
+            {
+                covered = contained(entries[i], entries[j]);
+            }
+            if (!covered) result.push_back(entries[i].set);
+        }
+        return result;
+    }
+
+    // множества, не содержащие строго ни одного другого
+    std::vector<SetT*> minimal() const
+    {
+        std::vector<SetT*> result;
+        for (std::size_t j = 0; j < entries.size(); j++)
+        {
+            bool covers_other = false;
+            for (std::size_t i = 0, end = first_with_size(entries[j].size); i < end && !covers_other; i++)
+            {
+                covers_other = contained(entries[i], entries[j]);
+            }
+            if (!covers_other) result.push_back(entries[j].set);
+        }
+        return result;
+    }
+};
+
+#endif //DISCRETE_MATHEMATICS_SUBSET_INDEX_H
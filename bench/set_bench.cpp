@@ -0,0 +1,396 @@
+// Микробенчмарки операций над множествами.
+//
+// set_bench [фильтр] [--min-time мс]
+//
+// Для каждого набора (хранилище, мощность, плотность) печатает время одной
+// операции, число выделений памяти и байт на операцию. Плотность - доля
+// элементов множества в диапазоне значений [0, size / density).
+// Выделения считаются подменой глобального operator new, поэтому учитываются
+// только аллокации внутри замеряемого участка.
+
+#include "../1task/1task.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#include <memory>
+#include <new>
+#include <ostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> allocated_bytes{0};
+
+    void *counted_allocate(std::size_t size, std::size_t align)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+        if (size == 0) size = 1;
+#ifdef _WIN32
+        void *ptr = align <= alignof(std::max_align_t) ? std::malloc(size) : _aligned_malloc(size, align);
+#else
+        void *ptr = align <= alignof(std::max_align_t)
+                    ? std::malloc(size)
+                    : std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+        if (ptr == nullptr) throw std::bad_alloc();
+        return ptr;
+    }
+
+    void aligned_free(void *ptr)
+    {
+#ifdef _WIN32
+        _aligned_free(ptr);
+#else
+        std::free(ptr);
+#endif
+    }
+}
+
+void *operator new(std::size_t size) { return counted_allocate(size, alignof(std::max_align_t)); }
+void *operator new[](std::size_t size) { return counted_allocate(size, alignof(std::max_align_t)); }
+void *operator new(std::size_t size, std::align_val_t align) { return counted_allocate(size, static_cast<std::size_t>(align)); }
+void *operator new[](std::size_t size, std::align_val_t align) { return counted_allocate(size, static_cast<std::size_t>(align)); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { aligned_free(ptr); }
+
+namespace
+{
+    struct BenchOptions
+    {
+        std::string filter;
+        double min_time_ms = 100;
+    };
+
+    BenchOptions options;
+
+    // поток, который ничего не пишет: pow меряется без затрат на вывод
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+        int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+    };
+
+    template <typename V>
+    void do_not_optimize(const V& value)
+    {
+#if defined(__GNUC__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile V sink;
+        sink = value;
+#endif
+    }
+
+    // setup() готовит состояние вне замера, body(state) замеряется и выполняет ops операций
+    template <typename Setup, typename Body>
+    void bench(const std::string& name, uint64_t ops, Setup setup, Body body)
+    {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+
+        using clock = std::chrono::steady_clock;
+        clock::duration elapsed{};
+        uint64_t iterations = 0;
+        uint64_t allocs = 0;
+        uint64_t bytes = 0;
+        const auto min_time = std::chrono::duration<double, std::milli>(options.min_time_ms);
+
+        while (iterations < 3 || elapsed < min_time)
+        {
+            auto state = setup();
+            uint64_t allocs_before = allocations.load(std::memory_order_relaxed);
+            uint64_t bytes_before = allocated_bytes.load(std::memory_order_relaxed);
+            auto start = clock::now();
+            body(state);
+            elapsed += clock::now() - start;
+            allocs += allocations.load(std::memory_order_relaxed) - allocs_before;
+            bytes += allocated_bytes.load(std::memory_order_relaxed) - bytes_before;
+            iterations++;
+        }
+
+        double total_ops = static_cast<double>(iterations) * static_cast<double>(ops);
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        std::printf("%-48s %12.2f %12.3f %12.1f\n", name.c_str(), ns / total_ops,
+                    static_cast<double>(allocs) / total_ops, static_cast<double>(bytes) / total_ops);
+    }
+
+    // size различных значений из [0, size / density) в случайном порядке
+    std::vector<int> random_values(std::size_t size, double density, uint32_t seed)
+    {
+        std::size_t universe = std::max(size, static_cast<std::size_t>(static_cast<double>(size) / density));
+        std::mt19937 gen(seed);
+        std::vector<bool> taken(universe);
+        std::vector<int> values;
+        values.reserve(size);
+        std::uniform_int_distribution<std::size_t> pick(0, universe - 1);
+        while (values.size() < size)
+        {
+            std::size_t v = pick(gen);
+            if (taken[v]) continue;
+            taken[v] = true;
+            values.push_back(static_cast<int>(v));
+        }
+        return values;
+    }
+
+    // значение для множества с элементами типа T: char-множество берёт значения со сдвигом в [-128, 127]
+    template <typename T>
+    T to_element(int value)
+    {
+        if constexpr (sizeof(T) == 1) return static_cast<T>(value - 128);
+        else return static_cast<T>(value);
+    }
+
+    template <typename SetT, typename T>
+    std::unique_ptr<SetT> make_set(const std::string& name, const std::vector<int>& values)
+    {
+        auto set = std::make_unique<SetT>(name);
+        for (int v : values) set->add(to_element<T>(v));
+        return set;
+    }
+
+    template <typename T, typename Storage>
+    void bench_backend(const std::string& backend, std::size_t size, double density)
+    {
+        using SetT = BasicSet<T, Storage>;
+
+        char label[64];
+        std::snprintf(label, sizeof(label), "/%s/n=%zu/d=%g", backend.c_str(), size, density);
+        const std::string suffix = label;
+
+        const std::vector<int> a_values = random_values(size, density, 1);
+        const std::vector<int> b_values = random_values(size, density, 2);
+
+        // половина запросов попадает в множество, половина - нет
+        std::vector<T> queries;
+        for (std::size_t i = 0; i < size; i++)
+        {
+            queries.push_back(to_element<T>(i % 2 == 0 ? a_values[i] : b_values[i]));
+        }
+
+        bench("add" + suffix, size,
+              [] { return std::make_unique<SetT>("A"); },
+              [&](auto& set)
+              {
+                  for (int v : a_values) set->add(to_element<T>(v));
+              });
+
+        // та же пачка с пропуском повторов; для массива - одно слияние вместо вставок
+        std::vector<T> a_elements;
+        for (int v : a_values) a_elements.push_back(to_element<T>(v));
+        bench("add_all" + suffix, size,
+              [] { return std::make_unique<SetT>("A"); },
+              [&](auto& set)
+              {
+                  std::size_t added = set->add_all(a_elements);
+                  do_not_optimize(added);
+              });
+
+        bench("rem" + suffix, size,
+              [&] { return make_set<SetT, T>("A", a_values); },
+              [&](auto& set)
+              {
+                  for (int v : a_values) set->rem(to_element<T>(v));
+              });
+
+        auto a = make_set<SetT, T>("A", a_values);
+        auto b = make_set<SetT, T>("B", b_values);
+        auto a_copy = make_set<SetT, T>("C", a_values);
+        auto none = [] { return 0; };
+
+        bench("contains" + suffix, size, none,
+              [&](int)
+              {
+                  std::size_t hits = 0;
+                  for (const T& q : queries) hits += a->contains(q);
+                  do_not_optimize(hits);
+              });
+
+        // выгрузка элементов: ns/op - на элемент
+        std::vector<T> exported(size);
+        bench("for_each" + suffix, size, none,
+              [&](int)
+              {
+                  uint64_t sum = 0;
+                  a->for_each([&sum](const T& value) { sum += static_cast<uint64_t>(value); });
+                  do_not_optimize(sum);
+              });
+        bench("copy_to" + suffix, size, none,
+              [&](int)
+              {
+                  std::size_t count = a->copy_to(exported);
+                  do_not_optimize(count);
+              });
+
+        // слияние короче одного замера часов, поэтому в замере их несколько
+        constexpr uint64_t repeat = 16;
+        bench("union_merge" + suffix, repeat, none,
+              [&](int)
+              {
+                  for (uint64_t i = 0; i < repeat; i++) delete a->union_merge(*b);
+              });
+        bench("intersection_merge" + suffix, repeat, none,
+              [&](int)
+              {
+                  for (uint64_t i = 0; i < repeat; i++) delete a->intersection_merge(*b);
+              });
+        bench("difference_merge" + suffix, repeat, none,
+              [&](int)
+              {
+                  for (uint64_t i = 0; i < repeat; i++) delete a->difference_merge(*b);
+              });
+        bench("symmetric_difference_merge" + suffix, repeat, none,
+              [&](int)
+              {
+                  for (uint64_t i = 0; i < repeat; i++) delete a->symmetric_difference_merge(*b);
+              });
+
+        // мощность пересечения подсчётом против построения множества-результата
+        bench("intersection_size" + suffix, repeat, none,
+              [&](int)
+              {
+                  for (uint64_t i = 0; i < repeat; i++) do_not_optimize(a->intersection_size(*b));
+              });
+        bench("intersection_merge_size" + suffix, repeat, none,
+              [&](int)
+              {
+                  for (uint64_t i = 0; i < repeat; i++)
+                  {
+                      std::unique_ptr<SetT> merged(a->intersection_merge(*b));
+                      do_not_optimize(merged->size());
+                  }
+              });
+
+        // оценка по сводкам HyperLogLog/MinHash против точного подсчёта
+        a->enable_sketch();
+        b->enable_sketch();
+        do_not_optimize(a->estimated_size() + b->estimated_size());
+        bench("union_size" + suffix, repeat, none,
+              [&](int)
+              {
+                  for (uint64_t i = 0; i < repeat; i++) do_not_optimize(a->union_size(*b));
+              });
+        bench("estimated_union_size" + suffix, repeat, none,
+              [&](int)
+              {
+                  for (uint64_t i = 0; i < repeat; i++) do_not_optimize(a->estimated_union_size(*b));
+              });
+        bench("estimated_jaccard" + suffix, repeat, none,
+              [&](int)
+              {
+                  for (uint64_t i = 0; i < repeat; i++) do_not_optimize(a->estimated_jaccard(*b));
+              });
+        a->disable_sketch();
+        b->disable_sketch();
+
+        // n-арные операции над fan_in множествами против цепочки попарных слияний
+        constexpr std::size_t fan_in = 8;
+        std::vector<std::unique_ptr<SetT>> many;
+        std::vector<const SetT*> operands;
+        for (std::size_t k = 0; k < fan_in; k++)
+        {
+            many.push_back(make_set<SetT, T>("F" + std::to_string(k),
+                                             random_values(size, density, static_cast<uint32_t>(3 + k))));
+            operands.push_back(many.back().get());
+        }
+        bench("union_all/k=8" + suffix, 1, none,
+              [&](int) { delete SetT::union_all(operands); });
+        bench("union_chain/k=8" + suffix, 1, none,
+              [&](int)
+              {
+                  std::unique_ptr<SetT> acc(operands[0]->union_merge(*operands[1]));
+                  for (std::size_t k = 2; k < fan_in; k++) acc.reset(acc->union_merge(*operands[k]));
+              });
+        bench("intersect_all/k=8" + suffix, 1, none,
+              [&](int) { delete SetT::intersect_all(operands); });
+
+        // равные множества - подмножество проверяется целиком
+        bench("is_subset_of" + suffix, repeat, none,
+              [&](int)
+              {
+                  for (uint64_t i = 0; i < repeat; i++)
+                  {
+                      bool subset = a->is_subset_of(*a_copy);
+                      do_not_optimize(subset);
+                  }
+              });
+    }
+
+    template <typename T, typename Storage>
+    void bench_pow(const std::string& backend, std::size_t elements)
+    {
+        using SetT = BasicSet<T, Storage>;
+
+        char label[64];
+        std::snprintf(label, sizeof(label), "pow/%s/n=%zu", backend.c_str(), elements);
+
+        NullBuffer null_buffer;
+        std::ostream null_out(&null_buffer);
+        std::vector<int> values(elements);
+        for (std::size_t i = 0; i < elements; i++) values[i] = static_cast<int>(i) + 'a' + 128;
+        auto set = make_set<SetT, T>("A", values);
+
+        // время и выделения - на одно подмножество
+        bench(label, uint64_t{1} << elements, [] { return 0; }, [&](int) { set->pow(null_out); });
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) options.min_time_ms = std::atof(argv[++i]);
+        else options.filter = argv[i];
+    }
+
+    std::printf("simd: %s\n", simd::level_name(simd::active_level()));
+    std::printf("%-48s %12s %12s %12s\n", "benchmark", "ns/op", "allocs/op", "bytes/op");
+
+    const double densities[] = {1.0, 0.1, 0.01};
+
+    // char-множество: все значения лежат в 256-элементном диапазоне
+    for (std::size_t size : {16, 128})
+    {
+        for (double density : {1.0, 0.5})
+        {
+            if (static_cast<double>(size) / density > 256) continue;
+            bench_backend<char, BitmapStorage<char>>("set", size, density);
+        }
+    }
+
+    for (std::size_t size : {64, 4096, 65536})
+    {
+        for (double density : densities)
+        {
+            bench_backend<int, BitmapStorage<int>>("bitmap", size, density);
+            bench_backend<int, SortedVectorStorage<int>>("sorted", size, density);
+            bench_backend<int, HashStorage<int>>("hash", size, density);
+            bench_backend<int, RoaringStorage<int>>("roaring", size, density);
+        }
+    }
+
+    bench_pow<char, BitmapStorage<char>>("set", 10);
+    bench_pow<char, BitmapStorage<char>>("set", 16);
+    bench_pow<int, SortedVectorStorage<int>>("sorted", 16);
+
+    return 0;
+}
@@ -0,0 +1,190 @@
+// Нагрузочная проверка реестра, отложенного освобождения и разделяемых хранилищ.
+//
+// registry_stress [--quick]
+//
+// 1. Писатели создают и удаляют именованные множества и результаты слияний (S1, S2, ...
+//    после того, как заняты буквы), читатели одновременно ищут постоянные множества
+//    под read_guard, сверяют найденное с ожидаемым и запрашивают надмножества.
+// 2. Больше потоков, чем слотов EpochReclaimer, читают одновременно: поиск не должен
+//    бросать исключений и ошибаться.
+// 3. Результаты слияний разделяют хранилище с операндами (copy-on-write); их изменение
+//    в одних потоках не должно менять операнды, которые читают другие.
+// Имеет смысл и без санитайзеров, но основная цель - сборка с -fsanitize=thread
+// или -fsanitize=address.
+
+#include "../1task/1task.h"
+
+#include <atomic>
+#include <barrier>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::atomic<long> failures{0};
+
+    void check(bool ok, const char *what)
+    {
+        if (!ok && failures.fetch_add(1) < 10) std::printf("ОШИБКА: %s\n", what);
+    }
+
+    void writers_and_readers(int rounds)
+    {
+        std::vector<Set*> stable;
+        for (int i = 0; i < 500; i++) stable.push_back(new Set("K" + std::to_string(i)));
+        for (int i = 0; i < 500; i++) stable[i]->add(static_cast<char>('a' + i % 26));
+
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> writers, readers;
+        for (int t = 0; t < 3; t++)
+        {
+            writers.emplace_back([&, t]
+            {
+                for (int i = 0; i < rounds; i++)
+                {
+                    Set *set = new Set("W" + std::to_string(t) + "_" + std::to_string(i));
+                    check(Set::find_set(set->get_name()) == set, "созданное множество не найдено");
+                    if (i % 3 != 0) Set::retire(set);
+                    Set *merged = stable[i % 500]->union_merge(*stable[(i + 1) % 500]);
+                    check(Set::find_set(merged->get_name()) == merged, "результат слияния не найден");
+                    Set::retire(merged);
+                }
+            });
+        }
+        for (int t = 0; t < 3; t++)
+        {
+            readers.emplace_back([&, t]
+            {
+                unsigned x = static_cast<unsigned>(t) + 1;
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    x = x * 1103515245 + 12345;
+                    int k = static_cast<int>((x >> 8) % 500);
+                    std::string name = "K" + std::to_string(k);
+                    auto guard = Set::read_guard();
+                    Set *set = Set::find_set(name);
+                    check(set == stable[k] && set->get_name() == name, "найдено не то множество");
+                    check(set->contains(static_cast<char>('a' + k % 26)), "содержимое множества изменилось");
+                    Set::find_set("W0_" + std::to_string(x % static_cast<unsigned>(rounds)));
+                    if (x % 64 == 0)
+                    {
+                        // индекс включений строится заново, пока писатели удаляют множества
+                        for (Set *found : Set::supersets_of(*set))
+                        {
+                            check(found->contains(static_cast<char>('a' + k % 26)), "неверное надмножество");
+                        }
+                    }
+                }
+            });
+        }
+        for (std::thread& writer : writers) writer.join();
+        stop = true;
+        for (std::thread& reader : readers) reader.join();
+
+        std::size_t live = 0;
+        for (int t = 0; t < 3; t++)
+        {
+            for (int i = 0; i < rounds; i += 3)
+            {
+                Set *set = Set::find_set("W" + std::to_string(t) + "_" + std::to_string(i));
+                live += set != nullptr;
+                if (set != nullptr) Set::retire(set);
+            }
+        }
+        check(live == 3 * static_cast<std::size_t>((rounds + 2) / 3), "потеряны или лишние множества");
+        for (Set *set : stable) Set::retire(set);
+    }
+
+    void more_readers_than_slots()
+    {
+        const int threads = static_cast<int>(EpochReclaimer<Set>::max_readers) + 72;
+        for (int i = 0; i < 300; i++) new Set("R" + std::to_string(i));
+
+        std::barrier sync(threads);
+        std::vector<std::thread> readers;
+        for (int t = 0; t < threads; t++)
+        {
+            readers.emplace_back([&, t]
+            {
+                check(Set::find_set("R" + std::to_string(t % 300)) != nullptr, "множество не найдено");
+                sync.arrive_and_wait(); // все потоки живы одновременно и уже заняли слоты
+                for (int i = 0; i < 100; i++)
+                {
+                    auto guard = Set::read_guard();
+                    check(Set::find_set("R" + std::to_string((t + i) % 300)) != nullptr, "множество не найдено");
+                    if (t % 20 == 0)
+                    {
+                        Set::retire(new Set("T" + std::to_string(t) + "_" + std::to_string(i)));
+                    }
+                }
+            });
+        }
+        for (std::thread& reader : readers) reader.join();
+        for (int i = 0; i < 300; i++) Set::retire(Set::find_set("R" + std::to_string(i)));
+    }
+
+    // a ⊇ b, поэтому a ∪ b разделяет хранилище с a; изменение результата копирует его
+    template <typename SetT, typename Make>
+    void copy_on_write(int rounds, Make make)
+    {
+        SetT *a = new SetT("COW_A");
+        SetT *b = new SetT("COW_B");
+        for (int i = 0; i < 40; i++) a->add(make(i));
+        for (int i = 0; i < 40; i += 2) b->add(make(i));
+
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 2; t++)
+        {
+            threads.emplace_back([&]
+            {
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    check(a->size() == 40 && a->contains(make(0)) && a->contains(make(39)), "операнд изменился");
+                    check(b->size() == 20 && !b->contains(make(1)), "операнд изменился");
+                }
+            });
+        }
+        for (int t = 0; t < 2; t++)
+        {
+            threads.emplace_back([&]
+            {
+                for (int i = 0; i < rounds; i++)
+                {
+                    SetT *merged = a->union_merge(*b);
+                    merged->add(make(50));
+                    merged->rem(make(0));
+                    SetT *common = a->intersection_merge(*b);
+                    common->add(make(51));
+                    check(merged->size() == 40 && common->size() == 21, "неверный результат после изменения");
+                    SetT::retire(merged);
+                    SetT::retire(common);
+                }
+            });
+        }
+        for (std::size_t t = 2; t < threads.size(); t++) threads[t].join();
+        stop = true;
+        threads[0].join();
+        threads[1].join();
+        check(a->size() == 40 && b->size() == 20, "операнды изменились");
+        SetT::retire(a);
+        SetT::retire(b);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool quick = argc > 1 && std::strcmp(argv[1], "--quick") == 0;
+    int rounds = quick ? 2000 : 20000;
+
+    writers_and_readers(rounds);
+    more_readers_than_slots();
+    copy_on_write<Set>(rounds, [](int i) { return static_cast<char>('A' + i); });
+    copy_on_write<SortedSet<int>>(rounds, [](int i) { return i * 7; });
+
+    if (failures == 0) std::printf("registry_stress: ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+// Подсчёт выделений памяти при разборе и выполнении команд REPL.
+//
+// repl_alloc_check
+//
+// Подменяет глобальный operator new счётчиком, включает 1task.cpp (его main
+// переименован) и выполняет каждую команду много раз после прогрева. Команды,
+// которые не меняют множества (see, stat, сравнение), не должны выделять память
+// вовсе; add/rem/undo/redo выделяют только блоки истории журнала (std::deque),
+// то есть в среднем заметно меньше одного раза на команду. Имя длиннее SSO-буфера
+// std::string, но не длиннее буфера UpperName (32 байта): более длинные имена
+// копируются в std::string.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<long> allocations{0};
+}
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size != 0 ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#define main repl_main
+#include "../1task/1task.cpp"
+#undef main
+
+#include <streambuf>
+
+namespace
+{
+    // поток, который ничего не хранит: вывод команд не должен влиять на счётчик
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        int overflow(int c) override
+        {
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char*, std::streamsize count) override
+        {
+            return count;
+        }
+    };
+
+    int failures = 0;
+
+    void measure(std::string_view command, double limit, std::ostream& out, const ReplOptions& options)
+    {
+        const int repeats = 1000;
+        execute_command(command, out, options); // прогрев
+        long before = allocations.load();
+        for (int i = 0; i < repeats; i++) execute_command(command, out, options);
+        double per_command = static_cast<double>(allocations.load() - before) / repeats;
+        bool ok = per_command <= limit;
+        if (!ok) failures++;
+        std::printf("%-32.*s %.3f выделений на команду%s\n", static_cast<int>(command.size()), command.data(),
+                    per_command, ok ? "" : " - ОШИБКА");
+    }
+}
+
+int main()
+{
+    NullBuffer sink;
+    std::ostream out(&sink);
+    SetJournal<Set> journal(64);
+    ReplOptions options;
+    options.quiet = true;
+    options.journal = &journal;
+
+    execute_command("new Alpha_name_longer_than_SSO", out, options);
+    execute_command("new B", out, options);
+    execute_command("add b a", out, options);
+
+    // только чтение
+    measure("see b", 0, out, options);
+    measure("see alpha_name_longer_than_sso", 0, out, options);
+    measure("b = b", 0, out, options);
+    measure("b < alpha_name_longer_than_sso", 0, out, options);
+    measure("stat b alpha_name_longer_than_sso", 0, out, options);
+
+    // изменения: пара команд возвращает множество в исходное состояние
+    measure("add b q", 0.25, out, options);
+    measure("rem b q", 0.25, out, options);
+    measure("  ADD   Alpha_name_longer_than_SSO   z  ", 0.25, out, options);
+    measure("undo", 0.25, out, options);
+    measure("redo", 0.25, out, options);
+
+    if (failures == 0) std::printf("repl_alloc_check: ok\n");
+    return failures == 0 ? 0 : 1;
+}
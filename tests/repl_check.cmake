@@ -0,0 +1,17 @@
+# Прогон сценария REPL и сравнение вывода с ожидаемым.
+#
+# cmake -DREPL=<set_repl> -DSCRIPT=<сценарий.txt> -DEXPECTED=<ожидаемый.out> -P repl_check.cmake
+#
+# Фактический вывод при расхождении сохраняется рядом, в текущем каталоге.
+
+execute_process(COMMAND ${REPL} ${SCRIPT} OUTPUT_VARIABLE actual RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${REPL} ${SCRIPT}: код возврата ${result}")
+endif()
+
+file(READ ${EXPECTED} expected)
+if(NOT actual STREQUAL expected)
+    get_filename_component(name ${SCRIPT} NAME_WE)
+    file(WRITE ${name}.actual "${actual}")
+    message(FATAL_ERROR "вывод ${SCRIPT} отличается от ${EXPECTED}, фактический вывод: ${name}.actual")
+endif()
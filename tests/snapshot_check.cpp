@@ -0,0 +1,113 @@
+// Проверка разбора снимка на испорченных файлах.
+//
+// snapshot_check
+//
+// Сохраняет снимок, портит его копии (обрезка, поля заголовка и индекса, сумма
+// которых переполняет uint64_t) и проверяет, что load_snapshot отвечает ошибкой
+// "повреждённый снимок", ничего не загрузив, а целый снимок загружается.
+
+#include "../1task/1task.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool ok, const std::string& what)
+    {
+        if (!ok)
+        {
+            std::printf("ОШИБКА: %s\n", what.c_str());
+            failures++;
+        }
+    }
+
+    std::vector<char> read_file(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void write_file(const std::string& path, const std::vector<char>& bytes)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    void put_u64(std::vector<char>& bytes, std::size_t offset, uint64_t value)
+    {
+        std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+
+    // испорченный снимок должен отвергаться целиком
+    void expect_corrupt(const std::string& path, const std::string& what)
+    {
+        try
+        {
+            Set::load_snapshot(path);
+            check(false, what + ": снимок загружен");
+        }
+        catch (const std::runtime_error& e)
+        {
+            check(std::string(e.what()).find("повреждённый снимок") != std::string::npos,
+                  what + ": неожиданная ошибка " + e.what());
+        }
+        check(Set::find_set("SNAPSHOT_A") == nullptr, what + ": множество зарегистрировано");
+    }
+}
+
+int main()
+{
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::string good = (dir / "snapshot_check.snap").string();
+    const std::string bad = (dir / "snapshot_check_bad.snap").string();
+
+    Set *a = new Set("SNAPSHOT_A");
+    a->add('x');
+    a->add('y');
+    Set::save_snapshot(good);
+    Set::retire(a);
+    const std::vector<char> bytes = read_file(good);
+
+    // обрезанный файл
+    write_file(bad, std::vector<char>(bytes.begin(), bytes.begin() + 5));
+    expect_corrupt(bad, "короче заголовка");
+    write_file(bad, std::vector<char>(bytes.begin(), bytes.end() - 8));
+    expect_corrupt(bad, "обрезан хвост");
+
+    // names_size (смещение 32 в SnapshotHeader): names_offset + names_size переполняется
+    std::vector<char> wrapped = bytes;
+    put_u64(wrapped, 32, ~uint64_t{0} - 0x4f);
+    write_file(bad, wrapped);
+    expect_corrupt(bad, "names_size переполняет сумму");
+
+    // name_offset первой SnapshotEntry (сразу за заголовком): name_offset + name_length переполняется
+    wrapped = bytes;
+    put_u64(wrapped, sizeof(SnapshotHeader), ~uint64_t{0});
+    write_file(bad, wrapped);
+    expect_corrupt(bad, "name_offset переполняет сумму");
+
+    wrapped = bytes;
+    put_u64(wrapped, sizeof(SnapshotHeader), 0x7f0000000000);
+    write_file(bad, wrapped);
+    expect_corrupt(bad, "name_offset за пределами файла");
+
+    check(Set::load_snapshot(good) == 1, "целый снимок не загружен");
+    Set *loaded = Set::find_set("SNAPSHOT_A");
+    check(loaded != nullptr && loaded->contains('x') && loaded->contains('y') && loaded->size() == 2,
+          "загруженное множество отличается от сохранённого");
+
+    std::filesystem::remove(good);
+    std::filesystem::remove(bad);
+    if (failures == 0) std::printf("snapshot_check: ok\n");
+    return failures == 0 ? 0 : 1;
+}
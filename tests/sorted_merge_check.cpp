@@ -0,0 +1,139 @@
+// Проверка слияний SortedVectorStorage на случайных массивах.
+//
+// sorted_merge_check
+//
+// unite и intersect сравниваются с std::set_union и std::set_intersection.
+// Результат, равный операнду, должен ссылаться на массив этого операнда,
+// остальные - иметь свой массив. Пары подбираются так, чтобы часто попадались
+// вложенные, равные, пустые и расходящиеся в начале или в самом конце массивы.
+
+#include "../1task/set_storage.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool ok, const std::string& what)
+    {
+        if (!ok && failures++ < 10) std::printf("ОШИБКА: %s\n", what.c_str());
+    }
+
+    template <typename T>
+    SortedVectorStorage<T> make_storage(const std::vector<T>& values)
+    {
+        SortedVectorStorage<T> storage;
+        for (const T& value : values) storage.append_sorted(value);
+        return storage;
+    }
+
+    template <typename T>
+    std::vector<T> to_vector(const SortedVectorStorage<T>& storage)
+    {
+        std::span<const T> items = storage.items();
+        return std::vector<T>(items.begin(), items.end());
+    }
+
+    template <typename T>
+    bool same_array(const SortedVectorStorage<T>& x, const SortedVectorStorage<T>& y)
+    {
+        return !x.empty() && x.items().data() == y.items().data();
+    }
+
+    // результат, равный операнду, ссылается на его массив, остальные - нет
+    template <typename T>
+    void check_sharing(const SortedVectorStorage<T>& out, const SortedVectorStorage<T>& a,
+                       const SortedVectorStorage<T>& b, bool equals_operand, const std::string& what)
+    {
+        if (out.empty()) return;
+        bool shared = same_array(out, a) || same_array(out, b);
+        check(shared == equals_operand, what + (shared ? " разделяет массив, не равный результату"
+                                                       : " не разделяет массив равного ему операнда"));
+    }
+
+    template <typename T>
+    void check_pair(const std::vector<T>& va, const std::vector<T>& vb, const std::string& what)
+    {
+        SortedVectorStorage<T> a = make_storage(va), b = make_storage(vb);
+
+        std::vector<T> expected;
+        std::set_union(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(expected));
+        SortedVectorStorage<T> out;
+        SortedVectorStorage<T>::unite(a, b, out);
+        check(to_vector(out) == expected, what + ": неверное объединение");
+        check_sharing(out, a, b, expected == va || expected == vb, what + ": объединение");
+
+        expected.clear();
+        std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(expected));
+        SortedVectorStorage<T> common;
+        SortedVectorStorage<T>::intersect(a, b, common);
+        check(to_vector(common) == expected, what + ": неверное пересечение");
+        check_sharing(common, a, b, expected == va || expected == vb, what + ": пересечение");
+    }
+
+    template <typename T>
+    std::vector<T> random_subset(const std::vector<T>& values, std::mt19937& rng, unsigned keep_percent)
+    {
+        std::vector<T> subset;
+        for (const T& value : values)
+        {
+            if (rng() % 100 < keep_percent) subset.push_back(value);
+        }
+        return subset;
+    }
+
+    template <typename T, typename Make>
+    void run(const char *type, Make make)
+    {
+        std::mt19937 rng(12345);
+        for (int round = 0; round < 4000; round++)
+        {
+            std::size_t n = rng() % 3 == 0 ? rng() % 8 : rng() % 300;
+            std::vector<T> universe;
+            for (std::size_t i = 0; i < n; i++) universe.push_back(make(static_cast<int>(i * 3)));
+
+            std::vector<T> va = random_subset(universe, rng, 20 + rng() % 81);
+            std::vector<T> vb;
+            switch (rng() % 5)
+            {
+            case 0: // равные
+                vb = va;
+                break;
+            case 1: // b ⊆ a
+                vb = random_subset(va, rng, 50 + rng() % 51);
+                break;
+            case 2: // отличаются первым или последним элементом и одним элементом за концом
+                vb = va;
+                if (!vb.empty()) vb.erase(rng() % 2 == 0 ? vb.begin() : vb.end() - 1);
+                vb.push_back(make(static_cast<int>(n * 3 + 1)));
+                std::swap(va, vb);
+                break;
+            default:
+                vb = random_subset(universe, rng, rng() % 101);
+                break;
+            }
+            check_pair(va, vb, std::string(type) + " раунд " + std::to_string(round));
+            check_pair(vb, va, std::string(type) + " раунд " + std::to_string(round) + " (b, a)");
+        }
+    }
+}
+
+int main()
+{
+    run<int>("int", [](int i) { return i; });
+    run<std::string>("string", [](int i)
+    {
+        char name[16];
+        std::snprintf(name, sizeof(name), "s%06d", i);
+        return std::string(name);
+    });
+
+    if (failures == 0) std::printf("sorted_merge_check: ok\n");
+    return failures == 0 ? 0 : 1;
+}